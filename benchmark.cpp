@@ -0,0 +1,602 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <boost/scope_exit.hpp>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <thread>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#ifdef ROCKCHIP
+#include "mpp_decoder.hpp"
+#endif
+#include "software_decoder.hpp"
+
+// MPP turns packets away once its input queue is full, so only run this far ahead of the frames coming out
+const uint64_t BENCHMARK_MAX_IN_FLIGHT = 8;
+
+static std::string GetFileName(const std::string& path)
+{
+  const size_t separator = path.find_last_of('/');
+  return (separator == std::string::npos) ? path : path.substr(separator + 1);
+}
+
+static double GetCPUTime()
+{
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage))
+  {
+    return 0.0;
+  }
+  return (static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0));
+}
+
+// Resident set in MB
+static double GetMemory()
+{
+  std::ifstream file("/proc/self/status");
+  std::string line;
+  while (std::getline(file, line))
+  {
+    if (boost::starts_with(line, "VmRSS:"))
+    {
+      return (std::strtod(line.c_str() + 6, nullptr) / 1024.0);
+    }
+  }
+  return 0.0;
+}
+
+static double GetPercentile(const std::vector<double>& sorted, const double percentile)
+{
+  if (sorted.empty())
+  {
+    return 0.0;
+  }
+  const size_t index = std::min(sorted.size() - 1, static_cast<size_t>((percentile / 100.0) * static_cast<double>(sorted.size())));
+  return sorted[index];
+}
+
+BENCHMARK::BENCHMARK()
+  : software_(false)
+{
+}
+
+BENCHMARK::~BENCHMARK()
+{
+  Destroy();
+}
+
+int BENCHMARK::Init(const std::string& manifest, const bool software)
+{
+  Destroy();
+#ifdef ROCKCHIP
+  software_ = software;
+#else
+  // Built without MPP, so avcodec is the only decoder there is
+  software_ = true;
+#endif
+  std::ifstream file(manifest);
+  if (!file.is_open())
+  {
+    std::cout << "Failed to open benchmark manifest: " << manifest << std::endl;
+    return -1;
+  }
+  const size_t separator = manifest.find_last_of('/');
+  const std::string directory = (separator == std::string::npos) ? std::string() : manifest.substr(0, separator + 1);
+  std::string line;
+  while (std::getline(file, line))
+  {
+    boost::trim(line);
+    if (line.empty() || (line[0] == '#'))
+    {
+      continue;
+    }
+    std::vector<std::string> tokens;
+    boost::split(tokens, line, boost::is_any_of(" \t,"), boost::token_compress_on);
+    if (tokens[0] == "concurrency")
+    {
+      for (size_t i = 1; i < tokens.size(); ++i)
+      {
+        const unsigned int concurrency = std::strtoul(tokens[i].c_str(), nullptr, 10);
+        if (concurrency == 0)
+        {
+          std::cout << "Invalid benchmark concurrency: " << tokens[i] << std::endl;
+          Destroy();
+          return -2;
+        }
+        concurrency_.push_back(concurrency);
+      }
+    }
+    else if (tokens[0] == "software")
+    {
+      software_ = true;
+    }
+    else
+    {
+      BENCHMARK_FILE benchmark_file((line[0] == '/') ? line : (directory + line));
+      struct stat st;
+      if (stat(benchmark_file.path_.c_str(), &st))
+      {
+        std::cout << "Failed to find benchmark file: " << benchmark_file.path_ << std::endl;
+        Destroy();
+        return -3;
+      }
+      benchmark_file.size_ = st.st_size;
+      files_.push_back(benchmark_file);
+    }
+  }
+  if (files_.empty())
+  {
+    std::cout << "Benchmark manifest has no files: " << manifest << std::endl;
+    return -4;
+  }
+  if (concurrency_.empty())
+  {
+    concurrency_ = { 1, 2, 4 };
+  }
+  return 0;
+}
+
+void BENCHMARK::Destroy()
+{
+  files_.clear();
+  concurrency_.clear();
+  software_ = false;
+  results_.clear();
+}
+
+int BENCHMARK::Run(const std::atomic<bool>& running, MEMORY& memory)
+{
+  results_.clear();
+  for (const unsigned int concurrency : concurrency_)
+  {
+    std::cout << "Benchmarking " << concurrency << " parallel decodes of " << files_.size() << " files" << std::endl;
+    std::vector<BENCHMARK_WORKER> workers(concurrency);
+    std::vector<std::thread> threads;
+    std::atomic<unsigned int> finished(0);
+    memory.ResetPeaks();
+    const uint64_t refused = memory.GetRefused();
+    const double cpu_start = GetCPUTime();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < concurrency; ++i)
+    {
+      // Each worker starts at a different file so they are not all demuxing the same one at once
+      threads.push_back(std::thread([this, &workers, &finished, &running, &memory, i](){ Decode(workers[i], i % files_.size(), running, memory); ++finished; }));
+    }
+    BENCHMARK_RESULT result;
+    result.concurrency_ = concurrency;
+    while (finished < concurrency)
+    {
+      result.memory_ = std::max(result.memory_, GetMemory());
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    for (std::thread& thread : threads)
+    {
+      thread.join();
+    }
+    result.seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.cpu_ = ((GetCPUTime() - cpu_start) / result.seconds_) * 100.0;
+    result.mpp_buffers_ = memory.GetTotal(MEMORY_CATEGORY::MPP_BUFFERS).peak_bytes_ / (1024.0 * 1024.0);
+    result.mpp_buffer_count_ = memory.GetTotal(MEMORY_CATEGORY::MPP_BUFFERS).peak_count_;
+    result.packets_ = memory.GetTotal(MEMORY_CATEGORY::PACKETS).peak_bytes_ / (1024.0 * 1024.0);
+    result.refused_ = memory.GetRefused() - refused;
+    std::vector<double> latencies;
+    for (const BENCHMARK_WORKER& worker : workers)
+    {
+      result.frames_ += worker.frames_;
+      result.errors_ += worker.errors_;
+      latencies.insert(latencies.end(), worker.latencies_.begin(), worker.latencies_.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    result.fps_ = static_cast<double>(result.frames_) / result.seconds_;
+    result.latency_p50_ = GetPercentile(latencies, 50.0);
+    result.latency_p95_ = GetPercentile(latencies, 95.0);
+    result.latency_p99_ = GetPercentile(latencies, 99.0);
+    if (!running)
+    {
+      std::cout << "Benchmark interrupted" << std::endl;
+      return -1;
+    }
+    results_.push_back(result);
+  }
+  // Comparison across the configurations
+  std::cout << std::setw(12) << "Concurrency" << std::setw(10) << "Frames" << std::setw(8) << "Errors" << std::setw(10) << "FPS" << std::setw(12) << "FPS/Stream" << std::setw(8) << "CPU%" << std::setw(10) << "MemMB" << std::setw(10) << "MPPMB" << std::setw(8) << "MPPBufs" << std::setw(10) << "PacketMB" << std::setw(8) << "Refused" << std::setw(10) << "P50ms" << std::setw(10) << "P95ms" << std::setw(10) << "P99ms" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  for (const BENCHMARK_RESULT& result : results_)
+  {
+    std::cout << std::setw(12) << result.concurrency_ << std::setw(10) << result.frames_ << std::setw(8) << result.errors_ << std::setw(10) << result.fps_ << std::setw(12) << (result.fps_ / result.concurrency_) << std::setw(8) << result.cpu_ << std::setw(10) << result.memory_ << std::setw(10) << result.mpp_buffers_ << std::setw(8) << result.mpp_buffer_count_ << std::setw(10) << result.packets_ << std::setw(8) << result.refused_ << std::setw(10) << result.latency_p50_ << std::setw(10) << result.latency_p95_ << std::setw(10) << result.latency_p99_ << std::endl;
+  }
+  std::cout << std::defaultfloat;
+  return 0;
+}
+
+int BENCHMARK::WriteReport(const std::string& path) const
+{
+  std::ofstream file(path);
+  if (!file.is_open())
+  {
+    std::cout << "Failed to open benchmark report: " << path << std::endl;
+    return -1;
+  }
+  // The corpus goes in the header so reports from different runs can be checked against each other
+  file << "# decoder," << (software_ ? "software" : "mpp") << std::endl;
+  for (const BENCHMARK_FILE& benchmark_file : files_)
+  {
+    file << "# file," << benchmark_file.path_ << "," << benchmark_file.size_ << std::endl;
+  }
+  file << "concurrency,frames,errors,seconds,fps,fps_per_stream,cpu_percent,memory_mb,latency_p50_ms,latency_p95_ms,latency_p99_ms,mpp_buffers_mb,mpp_buffers,packets_mb,refused" << std::endl;
+  for (const BENCHMARK_RESULT& result : results_)
+  {
+    file << result.concurrency_ << "," << result.frames_ << "," << result.errors_ << "," << result.seconds_ << "," << result.fps_ << "," << (result.fps_ / result.concurrency_) << "," << result.cpu_ << "," << result.memory_ << "," << result.latency_p50_ << "," << result.latency_p95_ << "," << result.latency_p99_ << "," << result.mpp_buffers_ << "," << result.mpp_buffer_count_ << "," << result.packets_ << "," << result.refused_ << std::endl;
+  }
+  if (!file.good())
+  {
+    std::cout << "Failed to write benchmark report: " << path << std::endl;
+    return -2;
+  }
+  return 0;
+}
+
+int BENCHMARK::CompareBaseline(const std::string& path, const double threshold) const
+{
+  std::ifstream file(path);
+  if (!file.is_open())
+  {
+    std::cout << "Failed to open benchmark baseline: " << path << std::endl;
+    return -1;
+  }
+  int ret = 0;
+  std::string decoder;
+  std::vector<std::pair<std::string, uint64_t>> baseline_files;
+  std::string line;
+  while (std::getline(file, line))
+  {
+    if (line.empty())
+    {
+      continue;
+    }
+    std::vector<std::string> columns;
+    boost::split(columns, line, boost::is_any_of(","));
+    if ((columns[0] == "# decoder") && (columns.size() >= 2))
+    {
+      decoder = columns[1];
+      continue;
+    }
+    else if ((columns[0] == "# file") && (columns.size() >= 3))
+    {
+      baseline_files.push_back(std::make_pair(GetFileName(columns[1]), std::strtoull(columns[2].c_str(), nullptr, 10)));
+      continue;
+    }
+    else if (!std::isdigit(static_cast<unsigned char>(line[0])))
+    {
+      continue;
+    }
+    if (columns.size() < 5)
+    {
+      std::cout << "Invalid benchmark baseline line: " << line << std::endl;
+      return -2;
+    }
+    const unsigned int concurrency = std::strtoul(columns[0].c_str(), nullptr, 10);
+    const uint64_t frames = std::strtoull(columns[1].c_str(), nullptr, 10);
+    const double fps = std::strtod(columns[4].c_str(), nullptr);
+    std::vector<BENCHMARK_RESULT>::const_iterator result = std::find_if(results_.cbegin(), results_.cend(), [concurrency](const BENCHMARK_RESULT& result){ return (result.concurrency_ == concurrency); });
+    if (result == results_.cend())
+    {
+      std::cout << "Concurrency " << concurrency << " is in the baseline but was not run" << std::endl;
+      ret = 1;
+      continue;
+    }
+    if (result->frames_ != frames)
+    {
+      std::cout << "Concurrency " << concurrency << " decoded " << result->frames_ << " frames against " << frames << " in the baseline, the corpus may differ" << std::endl;
+    }
+    if (fps <= 0.0)
+    {
+      std::cout << "Concurrency " << concurrency << " has no throughput in the baseline to compare against" << std::endl;
+      ret = 1;
+      continue;
+    }
+    const double change = ((result->fps_ - fps) / fps) * 100.0;
+    std::cout << "Concurrency " << concurrency << ": " << result->fps_ << "fps against " << fps << "fps baseline (" << change << "%)" << std::endl;
+    if (change < -threshold)
+    {
+      std::cout << "Throughput regression at concurrency " << concurrency << std::endl;
+      ret = 1;
+    }
+  }
+  // Numbers from a different decoder or corpus say nothing about a regression. The corpus is matched by file name and size, the paths depend on where it was run from
+  const std::string current_decoder = software_ ? "software" : "mpp";
+  if (decoder != current_decoder)
+  {
+    std::cout << "Baseline decoder " << (decoder.empty() ? std::string("unknown") : decoder) << " does not match " << current_decoder << std::endl;
+    ret = 1;
+  }
+  std::vector<std::pair<std::string, uint64_t>> current_files;
+  for (const BENCHMARK_FILE& benchmark_file : files_)
+  {
+    current_files.push_back(std::make_pair(GetFileName(benchmark_file.path_), benchmark_file.size_));
+  }
+  std::sort(baseline_files.begin(), baseline_files.end());
+  std::sort(current_files.begin(), current_files.end());
+  if (baseline_files != current_files)
+  {
+    std::cout << "Baseline corpus does not match this manifest" << std::endl;
+    ret = 1;
+  }
+  return ret;
+}
+
+void BENCHMARK::Decode(BENCHMARK_WORKER& worker, const size_t first_file, const std::atomic<bool>& running, MEMORY& memory) const
+{
+  for (size_t i = 0; (i < files_.size()) && running; ++i)
+  {
+    const std::string& path = files_[(first_file + i) % files_.size()].path_;
+    if (DecodeFile(worker, path, running, memory) < 0)
+    {
+      std::cout << "Failed to decode benchmark file: " << path << std::endl;
+      ++worker.errors_;
+    }
+  }
+}
+
+int BENCHMARK::DecodeFile(BENCHMARK_WORKER& worker, const std::string& path, const std::atomic<bool>& running, MEMORY& memory) const
+{
+  AVFormatContext* format_context = nullptr;
+  if (avformat_open_input(&format_context, path.c_str(), nullptr, nullptr) != 0)
+  {
+    std::cout << "Failed to open avformat file: " << path << std::endl;
+    return -1;
+  }
+  BOOST_SCOPE_EXIT(&format_context)
+  {
+    avformat_close_input(&format_context);
+  }
+  BOOST_SCOPE_EXIT_END
+  if (avformat_find_stream_info(format_context, nullptr) < 0)
+  {
+    std::cout << "Failed to find stream info: " << path << std::endl;
+    return -2;
+  }
+  // Same choice of decoder as playback, the VPU for H264 and avcodec for anything else
+  int stream = -1;
+  bool software = software_;
+#ifndef ROCKCHIP
+  software = true;
+#endif
+  for (unsigned int i = 0; i < format_context->nb_streams; i++)
+  {
+    if ((format_context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) && (format_context->streams[i]->codecpar->codec_id == AVCodecID::AV_CODEC_ID_H264))
+    {
+      stream = i;
+      break;
+    }
+  }
+  if (stream < 0)
+  {
+    for (unsigned int i = 0; i < format_context->nb_streams; i++)
+    {
+      if (format_context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+      {
+        stream = i;
+        software = true;
+        break;
+      }
+    }
+  }
+  if (stream < 0)
+  {
+    std::cout << "Failed to find video stream: " << path << std::endl;
+    return -3;
+  }
+  const int memory_stream = memory.Open(path, software ? 0 : EstimateStreamMemory(format_context->streams[stream]->codecpar->width, format_context->streams[stream]->codecpar->height));
+  if (memory_stream < 0)
+  {
+    return 1;
+  }
+  BOOST_SCOPE_EXIT(&memory, memory_stream)
+  {
+    memory.Close(memory_stream);
+  }
+  BOOST_SCOPE_EXIT_END
+#ifdef ROCKCHIP
+  MPP_DECODER mpp_decoder;
+#endif
+  SOFTWARE_DECODER software_decoder;
+#ifdef ROCKCHIP
+  if (software ? software_decoder.Init(format_context->streams[stream]->codecpar) : mpp_decoder.Init(format_context->streams[stream]->codecpar))
+#else
+  if (software_decoder.Init(format_context->streams[stream]->codecpar))
+#endif
+  {
+    std::cout << "Failed to initialise decoder: " << path << std::endl;
+    return -4;
+  }
+  AVPacket* packet = av_packet_alloc();
+  BOOST_SCOPE_EXIT(&packet)
+  {
+    av_packet_free(&packet);
+  }
+  BOOST_SCOPE_EXIT_END
+  worker.sent_.clear();
+  uint64_t sent = 0;
+  uint64_t received = 0;
+  // Collects whatever frames are ready, returning how many came out
+  const auto receive = [&]() -> uint64_t
+  {
+    uint64_t frames = 0;
+    while (true)
+    {
+      int64_t pts = 0;
+      if (software)
+      {
+        const AVFrame* frame = nullptr;
+        const int ret = software_decoder.GetFrame(frame);
+        if ((ret < 0) || (ret == 1))
+        {
+          worker.errors_ += (ret < 0) ? 1 : 0;
+          break;
+        }
+        else if (ret == 2)
+        {
+          ++worker.errors_;
+          ++frames;
+          continue;
+        }
+        pts = frame->pts;
+      }
+#ifdef ROCKCHIP
+      else
+      {
+        MppFrame frame = nullptr;
+        const int ret = mpp_decoder.GetFrame(frame);
+        if ((ret < 0) || (ret == 1))
+        {
+          worker.errors_ += (ret < 0) ? 1 : 0;
+          break;
+        }
+        else if (ret == 2)
+        {
+          continue;
+        }
+        else if (ret == 3)
+        {
+          ++worker.errors_;
+          ++frames;
+          continue;
+        }
+        pts = mpp_frame_get_pts(frame);
+        mpp_frame_deinit(&frame);
+      }
+#endif
+      ++frames;
+      ++worker.frames_;
+      std::map<int64_t, std::chrono::steady_clock::time_point>::iterator s = worker.sent_.find(pts);
+      if (s != worker.sent_.end())
+      {
+        worker.latencies_.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s->second).count());
+        worker.sent_.erase(s);
+      }
+    }
+    received += frames;
+    return frames;
+  };
+  while (running)
+  {
+    const int ret = av_read_frame(format_context, packet);
+    if (ret == AVERROR_EOF)
+    {
+      break;
+    }
+    else if (ret)
+    {
+      std::cout << "Failed to read frame: " << path << std::endl;
+      ++worker.errors_;
+      break;
+    }
+    if (packet->stream_index != stream)
+    {
+      av_packet_unref(packet);
+      continue;
+    }
+    worker.sent_[packet->pts] = std::chrono::steady_clock::now();
+#ifdef ROCKCHIP
+    if (software ? software_decoder.SendPacket(packet) : mpp_decoder.SendPacket(packet))
+#else
+    if (software_decoder.SendPacket(packet))
+#endif
+    {
+      ++worker.errors_;
+    }
+#ifdef ROCKCHIP
+    memory.Set(memory_stream, MEMORY_CATEGORY::PACKETS, packet->size + mpp_decoder.GetPacketBytes(), 1);
+#else
+    memory.Set(memory_stream, MEMORY_CATEGORY::PACKETS, packet->size, 1);
+#endif
+    av_packet_unref(packet);
+    ++sent;
+    receive();
+#ifdef ROCKCHIP
+    memory.Set(memory_stream, MEMORY_CATEGORY::MPP_BUFFERS, mpp_decoder.GetBufferBytes(), mpp_decoder.GetBufferCount());
+#endif
+    // Reordering can hold frames back, so do not wait forever for the decoder to catch up
+    std::chrono::steady_clock::time_point wait = std::chrono::steady_clock::now();
+    while (((sent - received) >= BENCHMARK_MAX_IN_FLIGHT) && ((std::chrono::steady_clock::now() - wait) < std::chrono::milliseconds(20)))
+    {
+      if (receive() == 0)
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      else
+      {
+        wait = std::chrono::steady_clock::now();
+      }
+    }
+  }
+  // Drain, avcodec says when it is done but MPP just stops producing frames
+  if (software)
+  {
+    software_decoder.SendPacket(nullptr);
+    while (running && receive())
+    {
+    }
+  }
+  else
+  {
+    std::chrono::steady_clock::time_point wait = std::chrono::steady_clock::now();
+    while ((received < sent) && running && ((std::chrono::steady_clock::now() - wait) < std::chrono::milliseconds(200)))
+    {
+      if (receive() == 0)
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      else
+      {
+        wait = std::chrono::steady_clock::now();
+      }
+    }
+  }
+  worker.sent_.clear();
+  return 0;
+}
+
+int RunBenchmark(const std::atomic<bool>& running, MEMORY& memory, const std::string& manifest, const bool software, const std::string& report, const std::string& baseline, const double threshold)
+{
+  BENCHMARK benchmark;
+  if (benchmark.Init(manifest, software))
+  {
+    std::cout << "Failed to initialise benchmark" << std::endl;
+    return -1;
+  }
+  if (benchmark.Run(running, memory))
+  {
+    std::cout << "Failed to run benchmark" << std::endl;
+    return -2;
+  }
+  if (benchmark.WriteReport(report))
+  {
+    return -3;
+  }
+  std::cout << "Benchmark report written to " << report << std::endl;
+  if (baseline.size())
+  {
+    // A regression returns 1 so scripts can tell it apart from the benchmark failing to run
+    const int ret = benchmark.CompareBaseline(baseline, threshold);
+    if (ret < 0)
+    {
+      return -4;
+    }
+    return ret;
+  }
+  return 0;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "memory.hpp"
+
+struct BENCHMARK_FILE
+{
+  BENCHMARK_FILE(const std::string& path)
+    : path_(path)
+    , size_(0)
+  {
+  }
+
+  std::string path_;
+  uint64_t size_;
+
+};
+
+// One worker decodes the whole corpus, so each configuration does the same work per stream
+struct BENCHMARK_WORKER
+{
+  BENCHMARK_WORKER()
+    : frames_(0)
+    , errors_(0)
+  {
+  }
+
+  uint64_t frames_;
+  uint64_t errors_;
+  std::vector<double> latencies_; // Milliseconds from the packet going in to its frame coming out
+  std::map<int64_t, std::chrono::steady_clock::time_point> sent_; // By pts
+
+};
+
+struct BENCHMARK_RESULT
+{
+  BENCHMARK_RESULT()
+    : concurrency_(0)
+    , frames_(0)
+    , errors_(0)
+    , seconds_(0.0)
+    , fps_(0.0)
+    , cpu_(0.0)
+    , memory_(0.0)
+    , mpp_buffers_(0.0)
+    , mpp_buffer_count_(0)
+    , packets_(0.0)
+    , refused_(0)
+    , latency_p50_(0.0)
+    , latency_p95_(0.0)
+    , latency_p99_(0.0)
+  {
+  }
+
+  unsigned int concurrency_;
+  uint64_t frames_;
+  uint64_t errors_;
+  double seconds_;
+  double fps_; // Across all streams
+  double cpu_; // Percent of one core
+  double memory_; // Peak resident MB
+  double mpp_buffers_; // Peak MB across all decoders
+  uint64_t mpp_buffer_count_; // Peak
+  double packets_; // Peak MB
+  uint64_t refused_; // Files the memory limit would not let open
+  double latency_p50_;
+  double latency_p95_;
+  double latency_p99_;
+
+};
+
+// Decodes a manifest of files headlessly at increasing numbers of parallel streams, as fast as the decoder allows
+// The manifest has one file per line, relative to the manifest, with optional "concurrency 1 2 4 8" and "software" lines and # comments
+class BENCHMARK
+{
+ public:
+
+  BENCHMARK();
+  ~BENCHMARK();
+
+  int Init(const std::string& manifest, const bool software);
+  void Destroy();
+
+  int Run(const std::atomic<bool>& running, MEMORY& memory);
+  int WriteReport(const std::string& path) const;
+  // Returns 1 if throughput at any concurrency dropped by more than threshold percent against the baseline report, or the baseline was from a different decoder, corpus or set of concurrencies
+  int CompareBaseline(const std::string& path, const double threshold) const;
+
+  const std::vector<BENCHMARK_RESULT>& GetResults() const { return results_; }
+
+ private:
+
+  void Decode(BENCHMARK_WORKER& worker, const size_t first_file, const std::atomic<bool>& running, MEMORY& memory) const;
+  // Returns 1 if the memory limit refused the file
+  int DecodeFile(BENCHMARK_WORKER& worker, const std::string& path, const std::atomic<bool>& running, MEMORY& memory) const;
+
+  std::vector<BENCHMARK_FILE> files_;
+  std::vector<unsigned int> concurrency_;
+  bool software_;
+  std::vector<BENCHMARK_RESULT> results_;
+
+};
+
+// Runs the manifest, writes the report and compares it against the baseline if there is one, returning 1 for a regression
+int RunBenchmark(const std::atomic<bool>& running, MEMORY& memory, const std::string& manifest, const bool software, const std::string& report, const std::string& baseline, const double threshold);
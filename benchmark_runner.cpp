@@ -0,0 +1,80 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <signal.h>
+#include <stdint.h>
+#include <string>
+
+#include "benchmark.hpp"
+#include "memory.hpp"
+
+// The benchmark on its own, without a window or GL, so it also builds off target where it always uses the software decoder
+
+std::atomic<bool> running = true;
+
+void sig(const int signum)
+{
+  running = false;
+}
+
+int main(int argc, char** argv)
+{
+  // Args
+  std::string manifest;
+  bool software = false;
+  std::string report = "benchmark.csv";
+  std::string baseline;
+  double threshold = 10.0;
+  uint64_t memory_limit = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--software")
+    {
+      software = true;
+    }
+    else if ((arg == "--benchmark-report") && ((i + 1) < argc))
+    {
+      report = argv[++i];
+    }
+    else if ((arg == "--benchmark-baseline") && ((i + 1) < argc))
+    {
+      baseline = argv[++i];
+    }
+    else if ((arg == "--benchmark-threshold") && ((i + 1) < argc))
+    {
+      threshold = std::atof(argv[++i]);
+    }
+    else if ((arg == "--memory-limit") && ((i + 1) < argc))
+    {
+      memory_limit = std::strtoull(argv[++i], nullptr, 10);
+    }
+    else
+    {
+      manifest = arg;
+    }
+  }
+  if (manifest.empty())
+  {
+    std::cout << "./RockchipPlayerBenchmark [--software] [--benchmark-report report.csv] [--benchmark-baseline baseline.csv] [--benchmark-threshold percent] [--memory-limit MB] manifest.txt" << std::endl;
+    return -1;
+  }
+  // Signals
+  struct sigaction sa;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_handler = sig;
+  sa.sa_flags = SA_RESTART;
+  if (sigaction(SIGINT, &sa, nullptr))
+  {
+    std::cout << "Failed to register SIGINT" << std::endl;
+    return -2;
+  }
+  if (sigaction(SIGTERM, &sa, nullptr))
+  {
+    std::cout << "Failed to register SIGTERM" << std::endl;
+    return -3;
+  }
+  MEMORY memory;
+  memory.SetLimit(memory_limit * 1024 * 1024);
+  return RunBenchmark(running, memory, manifest, software, report, baseline, threshold);
+}
@@ -0,0 +1,68 @@
+#include "bitstream.hpp"
+
+#include <cstring>
+#include <iostream>
+
+int SplitAVCCPacket(const uint8_t* data, const size_t size, std::vector<H264_NAL>& nals)
+{
+  nals.clear();
+  const uint8_t* ptr = data;
+  size_t remaining = size;
+  while (remaining > 5)
+  {
+    // Big endian, and the packet gives no alignment guarantees
+    const size_t nal_size = (static_cast<size_t>(ptr[0]) << 24) | (static_cast<size_t>(ptr[1]) << 16) | (static_cast<size_t>(ptr[2]) << 8) | static_cast<size_t>(ptr[3]);
+    ptr += 4;
+    remaining -= 4;
+    if (nal_size > remaining)
+    {
+      std::cout << "Illegal NAL size " << nal_size << std::endl;
+      return 1;
+    }
+    nals.push_back(H264_NAL(ptr, nal_size));
+    ptr += nal_size;
+    remaining -= nal_size;
+  }
+  return 0;
+}
+
+void WriteAnnexBNAL(const uint8_t* nal, const size_t size, uint8_t* buffer)
+{
+  memcpy(buffer, H264_START_SEQUENCE, sizeof(H264_START_SEQUENCE));
+  memcpy(buffer + sizeof(H264_START_SEQUENCE), nal, size);
+}
+
+void ParseAVCCExtradata(const uint8_t* extradata, const size_t size, std::vector<uint8_t>& spspps)
+{
+  spspps.clear();
+  if ((extradata == nullptr) || (size < 8))
+  {
+    return;
+  }
+  if (extradata[0] >= 1) // SPS+PPS count, but we only care about the first one
+  {
+    const size_t spsnalsize = (extradata[6] << 8) | extradata[7];
+    if ((spsnalsize + 8) <= size)
+    {
+      std::cout << "Gathering SPS: " << spsnalsize << std::endl;
+      spspps.insert(spspps.end(), extradata + 8, extradata + 8 + spsnalsize);
+      if ((spsnalsize + 8 + 1) <= size)
+      {
+        const int ppscount = extradata[8 + spsnalsize] & 0x1f;
+        if (ppscount >= 1)
+        {
+          if ((spsnalsize + 8 + 1 + 2) < size)
+          {
+            const size_t ppsnalsize = (extradata[8 + spsnalsize + 1] << 8) | extradata[8 + spsnalsize + 2];
+            if ((spsnalsize + 8 + 1 + 2 + ppsnalsize) <= size)
+            {
+              std::cout << "Gathering PPS: " << ppsnalsize << std::endl;
+              spspps.insert(spspps.end(), H264_START_SEQUENCE, H264_START_SEQUENCE + sizeof(H264_START_SEQUENCE));
+              spspps.insert(spspps.end(), extradata + 8 + spsnalsize + 3, extradata + 8 + spsnalsize + 3 + ppsnalsize);
+            }
+          }
+        }
+      }
+    }
+  }
+}
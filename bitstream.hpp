@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+const uint8_t H264_START_SEQUENCE[] = { 0, 0, 0, 1 };
+
+struct H264_NAL
+{
+  H264_NAL(const uint8_t* data, const size_t size)
+    : data_(data)
+    , size_(size)
+  {
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+
+};
+
+// Splits a packet of 4 byte length prefixed NALs as found in MP4, the NALs point into the packet. Returns 1 if the packet is malformed, nals then holds those before the error
+int SplitAVCCPacket(const uint8_t* data, const size_t size, std::vector<H264_NAL>& nals);
+// Writes a start code followed by the NAL, buffer must hold size + sizeof(H264_START_SEQUENCE)
+void WriteAnnexBNAL(const uint8_t* nal, const size_t size, uint8_t* buffer);
+// Pulls the first SPS and PPS out of an avcC box as start code separated NALs, the first start code is left to the caller
+void ParseAVCCExtradata(const uint8_t* extradata, const size_t size, std::vector<uint8_t>& spspps);
@@ -0,0 +1,57 @@
+#include "colour.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+YUV_MATRIX GetYUVMatrix(const YUV_COLOUR_SPACE colour_space, const bool full_range)
+{
+  float kr = 0.299f;
+  float kb = 0.114f;
+  if (colour_space == YUV_COLOUR_SPACE::BT709)
+  {
+    kr = 0.2126f;
+    kb = 0.0722f;
+  }
+  else if (colour_space == YUV_COLOUR_SPACE::BT2020)
+  {
+    kr = 0.2627f;
+    kb = 0.0593f;
+  }
+  const float kg = 1.0f - kr - kb;
+  // Limited range puts luma in 16-235 and chroma in 16-240
+  const float luma_scale = full_range ? 1.0f : (255.0f / 219.0f);
+  const float chroma_scale = full_range ? 1.0f : (255.0f / 224.0f);
+  const float rv = 2.0f * (1.0f - kr) * chroma_scale;
+  const float gu = -(2.0f * kb * (1.0f - kb) / kg) * chroma_scale;
+  const float gv = -(2.0f * kr * (1.0f - kr) / kg) * chroma_scale;
+  const float bu = 2.0f * (1.0f - kb) * chroma_scale;
+  YUV_MATRIX yuv_matrix =
+  {
+    {
+      luma_scale, luma_scale, luma_scale, // Y column
+      0.0f, gu, bu, // U column
+      rv, gv, 0.0f // V column
+    },
+    {
+      full_range ? 0.0f : (16.0f / 255.0f),
+      128.0f / 255.0f,
+      128.0f / 255.0f
+    }
+  };
+  return yuv_matrix;
+}
+
+void YUVToRGB(const YUV_MATRIX& yuv_matrix, const uint8_t y, const uint8_t u, const uint8_t v, uint8_t* rgb)
+{
+  const float yuv[3] =
+  {
+    (static_cast<float>(y) / 255.0f) - yuv_matrix.offset_[0],
+    (static_cast<float>(u) / 255.0f) - yuv_matrix.offset_[1],
+    (static_cast<float>(v) / 255.0f) - yuv_matrix.offset_[2]
+  };
+  for (int i = 0; i < 3; ++i)
+  {
+    const float value = (yuv_matrix.matrix_[i] * yuv[0]) + (yuv_matrix.matrix_[3 + i] * yuv[1]) + (yuv_matrix.matrix_[6 + i] * yuv[2]);
+    rgb[i] = static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+  }
+}
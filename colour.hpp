@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+enum class YUV_COLOUR_SPACE
+{
+  BT601,
+  BT709,
+  BT2020
+};
+
+// rgb = matrix * (yuv - offset), with everything normalised to 0-1 and the matrix column major so it can go straight to glUniformMatrix3fv
+struct YUV_MATRIX
+{
+  float matrix_[9];
+  float offset_[3];
+
+};
+
+YUV_MATRIX GetYUVMatrix(const YUV_COLOUR_SPACE colour_space, const bool full_range);
+// CPU reference of the conversion the shader does
+void YUVToRGB(const YUV_MATRIX& yuv_matrix, const uint8_t y, const uint8_t u, const uint8_t v, uint8_t* rgb);
@@ -0,0 +1,126 @@
+#include "display.hpp"
+
+#include <algorithm>
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+DISPLAY_TRANSFORM GetDisplayTransform(const int video_width, const int video_height, const int window_width, const int window_height, const DISPLAY_SCALING scaling, const DISPLAY_ROI& roi)
+{
+  DISPLAY_TRANSFORM transform =
+  {
+    { 1.0f, 1.0f, 0.0f, 0.0f },
+    { 1.0f, 1.0f, 0.0f, 0.0f }
+  };
+  if ((video_width <= 0) || (video_height <= 0) || (window_width <= 0) || (window_height <= 0))
+  {
+    return transform;
+  }
+  const float video_aspect = static_cast<float>(video_width) / static_cast<float>(video_height);
+  const float window_aspect = static_cast<float>(window_width) / static_cast<float>(window_height);
+  float width = 1.0f / roi.zoom_;
+  float height = 1.0f / roi.zoom_;
+  if (scaling == DISPLAY_SCALING::LETTERBOX)
+  {
+    // Shrink the quad to the picture's aspect, the clear colour fills the bars
+    if (video_aspect > window_aspect)
+    {
+      transform.position_[1] = window_aspect / video_aspect;
+    }
+    else
+    {
+      transform.position_[0] = video_aspect / window_aspect;
+    }
+  }
+  else if (scaling == DISPLAY_SCALING::FILL)
+  {
+    // Keep the quad covering the window and sample less of the picture instead
+    if (video_aspect > window_aspect)
+    {
+      width *= window_aspect / video_aspect;
+    }
+    else
+    {
+      height *= video_aspect / window_aspect;
+    }
+  }
+  const float x = std::clamp(roi.x_, width / 2.0f, 1.0f - (width / 2.0f));
+  const float y = std::clamp(roi.y_, height / 2.0f, 1.0f - (height / 2.0f));
+  // Texture rows are bottom up, so the bottom of the ROI is where t starts
+  transform.texcoord_[0] = width;
+  transform.texcoord_[1] = height;
+  transform.texcoord_[2] = x - (width / 2.0f);
+  transform.texcoord_[3] = 1.0f - (y + (height / 2.0f));
+  return transform;
+}
+
+void ClampDisplayROI(DISPLAY_ROI& roi)
+{
+  roi.zoom_ = std::clamp(roi.zoom_, 1.0f, DISPLAY_MAX_ZOOM);
+  const float half = 0.5f / roi.zoom_;
+  roi.x_ = std::clamp(roi.x_, half, 1.0f - half);
+  roi.y_ = std::clamp(roi.y_, half, 1.0f - half);
+}
+
+void ZoomDisplayROI(DISPLAY_ROI& roi, const DISPLAY_TRANSFORM& transform, const float factor, const float cursor_x, const float cursor_y, const int window_width, const int window_height)
+{
+  if ((window_width <= 0) || (window_height <= 0))
+  {
+    return;
+  }
+  // Where the cursor is on the quad, and so in the picture
+  const float u = std::clamp(((((cursor_x / window_width) * 2.0f) - 1.0f - transform.position_[2]) / transform.position_[0] * 0.5f) + 0.5f, 0.0f, 1.0f);
+  const float v = std::clamp(((1.0f - ((cursor_y / window_height) * 2.0f) - transform.position_[3]) / transform.position_[1] * 0.5f) + 0.5f, 0.0f, 1.0f);
+  const float picture_x = transform.texcoord_[2] + (u * transform.texcoord_[0]);
+  const float picture_y = 1.0f - (transform.texcoord_[3] + (v * transform.texcoord_[1]));
+  const float zoom = std::clamp(roi.zoom_ * factor, 1.0f, DISPLAY_MAX_ZOOM);
+  const float ratio = roi.zoom_ / zoom;
+  roi.zoom_ = zoom;
+  roi.x_ = picture_x - ((u - 0.5f) * transform.texcoord_[0] * ratio);
+  roi.y_ = picture_y + ((v - 0.5f) * transform.texcoord_[1] * ratio);
+  ClampDisplayROI(roi);
+}
+
+void PanDisplayROI(DISPLAY_ROI& roi, const DISPLAY_TRANSFORM& transform, const float delta_x, const float delta_y, const int window_width, const int window_height)
+{
+  if ((window_width <= 0) || (window_height <= 0))
+  {
+    return;
+  }
+  // Start from the centre actually shown, which crop to fill may have clamped further
+  roi.x_ = transform.texcoord_[2] + (transform.texcoord_[0] / 2.0f) - (delta_x / (transform.position_[0] * window_width) * transform.texcoord_[0]);
+  roi.y_ = 1.0f - (transform.texcoord_[3] + (transform.texcoord_[1] / 2.0f)) - (delta_y / (transform.position_[1] * window_height) * transform.texcoord_[1]);
+  ClampDisplayROI(roi);
+}
+
+int SetFullscreen(GLFWwindow* window, const bool fullscreen, DISPLAY_WINDOW& windowed)
+{
+  if (fullscreen == (glfwGetWindowMonitor(window) != nullptr))
+  {
+    return 0;
+  }
+  if (fullscreen)
+  {
+    GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+    const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+    if (mode == nullptr)
+    {
+      std::cout << "Failed to retrieve monitor video mode" << std::endl;
+      return -1;
+    }
+    glfwGetWindowPos(window, &windowed.x_, &windowed.y_);
+    glfwGetWindowSize(window, &windowed.width_, &windowed.height_);
+    glfwSetWindowMonitor(window, monitor, 0, 0, mode->width, mode->height, mode->refreshRate);
+  }
+  else
+  {
+    // Started fullscreen, so there is no previous window to go back to
+    if ((windowed.width_ <= 0) || (windowed.height_ <= 0))
+    {
+      windowed = DISPLAY_WINDOW();
+      windowed.width_ = DISPLAY_DEFAULT_WIDTH;
+      windowed.height_ = DISPLAY_DEFAULT_HEIGHT;
+    }
+    glfwSetWindowMonitor(window, nullptr, windowed.x_, windowed.y_, windowed.width_, windowed.height_, GLFW_DONT_CARE);
+  }
+  return 0;
+}
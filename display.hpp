@@ -0,0 +1,65 @@
+#pragma once
+
+struct GLFWwindow;
+
+enum class DISPLAY_SCALING
+{
+  LETTERBOX,
+  FILL,
+  STRETCH
+};
+
+// The part of the picture being shown, as a zoom and a centre in 0-1 picture coordinates with y down
+struct DISPLAY_ROI
+{
+  DISPLAY_ROI()
+    : zoom_(1.0f)
+    , x_(0.5f)
+    , y_(0.5f)
+  {
+  }
+
+  float zoom_;
+  float x_;
+  float y_;
+
+};
+
+// Scale and offset for the display quad, applied in the vertex shader so scaling, cropping and zooming cost nothing extra
+struct DISPLAY_TRANSFORM
+{
+  float position_[4]; // Scale xy, offset zw in clip space
+  float texcoord_[4]; // Scale xy, offset zw in texture space
+
+};
+
+// Window position and size to go back to when leaving fullscreen
+struct DISPLAY_WINDOW
+{
+  DISPLAY_WINDOW()
+    : x_(0)
+    , y_(0)
+    , width_(0)
+    , height_(0)
+  {
+  }
+
+  int x_;
+  int y_;
+  int width_;
+  int height_;
+
+};
+
+const int DISPLAY_DEFAULT_WIDTH = 1024;
+const int DISPLAY_DEFAULT_HEIGHT = 768;
+const float DISPLAY_MAX_ZOOM = 16.0f;
+
+DISPLAY_TRANSFORM GetDisplayTransform(const int video_width, const int video_height, const int window_width, const int window_height, const DISPLAY_SCALING scaling, const DISPLAY_ROI& roi);
+// Keeps the ROI inside the picture
+void ClampDisplayROI(DISPLAY_ROI& roi);
+// Zooms by factor keeping the picture under the cursor where it is, the cursor is in window pixels
+void ZoomDisplayROI(DISPLAY_ROI& roi, const DISPLAY_TRANSFORM& transform, const float factor, const float cursor_x, const float cursor_y, const int window_width, const int window_height);
+// Drags the picture by a window pixel delta
+void PanDisplayROI(DISPLAY_ROI& roi, const DISPLAY_TRANSFORM& transform, const float delta_x, const float delta_y, const int window_width, const int window_height);
+int SetFullscreen(GLFWwindow* window, const bool fullscreen, DISPLAY_WINDOW& windowed);
@@ -0,0 +1,40 @@
+#include "egl_image.hpp"
+
+const EGLint EGL_IMAGE_PLANE_ATTRIBUTES[EGL_IMAGE_MAX_PLANES][3] =
+{
+  { EGL_DMA_BUF_PLANE0_FD_EXT, EGL_DMA_BUF_PLANE0_OFFSET_EXT, EGL_DMA_BUF_PLANE0_PITCH_EXT },
+  { EGL_DMA_BUF_PLANE1_FD_EXT, EGL_DMA_BUF_PLANE1_OFFSET_EXT, EGL_DMA_BUF_PLANE1_PITCH_EXT },
+  { EGL_DMA_BUF_PLANE2_FD_EXT, EGL_DMA_BUF_PLANE2_OFFSET_EXT, EGL_DMA_BUF_PLANE2_PITCH_EXT }
+};
+
+size_t GetEGLImageAttributes(EGLint (&attributes)[EGL_IMAGE_MAX_ATTRIBUTES], const int fd, const uint32_t width, const uint32_t height, const uint32_t fourcc, const EGL_IMAGE_PLANE* planes, const size_t plane_count, const EGLint colour_space, const EGLint colour_range)
+{
+  size_t i = 0;
+  attributes[i++] = EGL_WIDTH;
+  attributes[i++] = static_cast<EGLint>(width);
+  attributes[i++] = EGL_HEIGHT;
+  attributes[i++] = static_cast<EGLint>(height);
+  attributes[i++] = EGL_LINUX_DRM_FOURCC_EXT;
+  attributes[i++] = static_cast<EGLint>(fourcc);
+  for (size_t plane = 0; (plane < plane_count) && (plane < EGL_IMAGE_MAX_PLANES); ++plane)
+  {
+    attributes[i++] = EGL_IMAGE_PLANE_ATTRIBUTES[plane][0];
+    attributes[i++] = fd;
+    attributes[i++] = EGL_IMAGE_PLANE_ATTRIBUTES[plane][1];
+    attributes[i++] = static_cast<EGLint>(planes[plane].offset_);
+    attributes[i++] = EGL_IMAGE_PLANE_ATTRIBUTES[plane][2];
+    attributes[i++] = static_cast<EGLint>(planes[plane].pitch_);
+  }
+  if (colour_space)
+  {
+    attributes[i++] = EGL_YUV_COLOR_SPACE_HINT_EXT;
+    attributes[i++] = colour_space;
+  }
+  if (colour_range)
+  {
+    attributes[i++] = EGL_SAMPLE_RANGE_HINT_EXT;
+    attributes[i++] = colour_range;
+  }
+  attributes[i++] = EGL_NONE;
+  return i;
+}
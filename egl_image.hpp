@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdint.h>
+
+const size_t EGL_IMAGE_MAX_PLANES = 3;
+const size_t EGL_IMAGE_MAX_ATTRIBUTES = 6 + (EGL_IMAGE_MAX_PLANES * 6) + 4 + 1;
+
+struct EGL_IMAGE_PLANE
+{
+  uint32_t offset_;
+  uint32_t pitch_;
+};
+
+// Fills in the attributes for importing a dma-buf with eglCreateImageKHR, every plane is in the same fd. Colour hints of 0 are left out, returns the count including EGL_NONE
+size_t GetEGLImageAttributes(EGLint (&attributes)[EGL_IMAGE_MAX_ATTRIBUTES], const int fd, const uint32_t width, const uint32_t height, const uint32_t fourcc, const EGL_IMAGE_PLANE* planes, const size_t plane_count, const EGLint colour_space, const EGLint colour_range);
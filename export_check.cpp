@@ -0,0 +1,219 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <drm/drm_fourcc.h>
+#include <iostream>
+#include <poll.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include "frame_export.hpp"
+#include "memfd_producer.hpp"
+
+// A minimal export subscriber. It connects to the socket, subscribes, and checks every frame arrives with a mappable fd and can be released
+// More frames than the producer has buffers are asked for, so the run only finishes if releases actually give the buffers back
+// With --stand-in it hosts the memfd producer itself and also checks the pixels, so it runs anywhere as a test
+
+const uint64_t CHECK_FRAMES = 32;
+const int CHECK_TIMEOUT = 2000; // Milliseconds for each frame
+const uint32_t CHECK_WIDTH = 320;
+const uint32_t CHECK_HEIGHT = 240;
+const size_t CHECK_BUFFERS = 4;
+
+static int ReceiveFrame(const int fd, FRAME_EXPORT_FRAME& header, int& frame_fd)
+{
+  frame_fd = -1;
+  pollfd pfd = { fd, POLLIN, 0 };
+  if (poll(&pfd, 1, CHECK_TIMEOUT) != 1)
+  {
+    std::cout << "Timed out waiting for a frame" << std::endl;
+    return -1;
+  }
+  iovec iov;
+  iov.iov_base = &header;
+  iov.iov_len = sizeof(header);
+  char control[CMSG_SPACE(sizeof(int))];
+  std::memset(control, 0, sizeof(control));
+  msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  if (recvmsg(fd, &msg, MSG_CMSG_CLOEXEC) != static_cast<ssize_t>(sizeof(header)))
+  {
+    std::cout << "Failed to receive frame" << std::endl;
+    return -2;
+  }
+  const cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if ((cmsg == nullptr) || (cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS))
+  {
+    std::cout << "Frame arrived without an fd" << std::endl;
+    return -3;
+  }
+  std::memcpy(&frame_fd, CMSG_DATA(cmsg), sizeof(int));
+  if (header.type_ != FRAME_EXPORT_MESSAGE_FRAME)
+  {
+    std::cout << "Unexpected message type: " << header.type_ << std::endl;
+    close(frame_fd);
+    frame_fd = -1;
+    return -4;
+  }
+  return 0;
+}
+
+// The stand-in writes a luma ramp of x + y + pts
+static int CheckPixels(const FRAME_EXPORT_FRAME& header, const uint8_t* ptr)
+{
+  if ((header.width_ != CHECK_WIDTH) || (header.height_ != CHECK_HEIGHT) || (header.drm_format_ != DRM_FORMAT_NV12) || (header.plane_count_ != 2) || (header.colour_space_ != FRAME_EXPORT_COLOUR_SPACE_BT709) || (header.colour_range_ != FRAME_EXPORT_COLOUR_RANGE_LIMITED))
+  {
+    std::cout << "Unexpected frame header" << std::endl;
+    return -1;
+  }
+  for (uint32_t y = 0; y < header.height_; y += 17)
+  {
+    for (uint32_t x = 0; x < header.width_; x += 13)
+    {
+      if (ptr[header.planes_[0].offset_ + (y * header.planes_[0].pitch_) + x] != static_cast<uint8_t>(x + y + header.pts_))
+      {
+        std::cout << "Unexpected luma at " << x << "x" << y << std::endl;
+        return -2;
+      }
+    }
+  }
+  if (ptr[header.planes_[1].offset_] != 128)
+  {
+    std::cout << "Unexpected chroma" << std::endl;
+    return -3;
+  }
+  return 0;
+}
+
+static int Subscribe(const std::string& path, const bool stand_in)
+{
+  const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd == -1)
+  {
+    std::cout << "Failed to create socket" << std::endl;
+    return -1;
+  }
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)))
+  {
+    std::cout << "Failed to connect to export socket: " << path << std::endl;
+    close(fd);
+    return -2;
+  }
+  const FRAME_EXPORT_SUBSCRIBE subscribe = { FRAME_EXPORT_MESSAGE_SUBSCRIBE, 0 };
+  if (send(fd, &subscribe, sizeof(subscribe), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(subscribe)))
+  {
+    std::cout << "Failed to subscribe" << std::endl;
+    close(fd);
+    return -3;
+  }
+  int ret = 0;
+  uint64_t received = 0;
+  while (received < CHECK_FRAMES)
+  {
+    FRAME_EXPORT_FRAME header;
+    int frame_fd = -1;
+    if (ReceiveFrame(fd, header, frame_fd))
+    {
+      ret = -4;
+      break;
+    }
+    void* ptr = mmap(nullptr, header.size_, PROT_READ, MAP_SHARED, frame_fd, 0);
+    close(frame_fd);
+    if (ptr == MAP_FAILED)
+    {
+      std::cout << "Failed to map frame" << std::endl;
+      ret = -5;
+      break;
+    }
+    const int pixels = stand_in ? CheckPixels(header, reinterpret_cast<const uint8_t*>(ptr)) : 0;
+    munmap(ptr, header.size_);
+    if (pixels)
+    {
+      ret = -6;
+      break;
+    }
+    const FRAME_EXPORT_RELEASE release = { FRAME_EXPORT_MESSAGE_RELEASE, 0, header.id_ };
+    if (send(fd, &release, sizeof(release), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(release)))
+    {
+      std::cout << "Failed to release frame" << std::endl;
+      ret = -7;
+      break;
+    }
+    ++received;
+  }
+  close(fd);
+  std::cout << "Received and released " << received << " frames" << std::endl;
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  // Args
+  std::string path;
+  bool stand_in = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--stand-in")
+    {
+      stand_in = true;
+    }
+    else
+    {
+      path = arg;
+    }
+  }
+  if (path.empty())
+  {
+    std::cout << "./RockchipPlayerExportCheck [--stand-in] socket" << std::endl;
+    return -1;
+  }
+  if (!stand_in)
+  {
+    return Subscribe(path, false);
+  }
+  FRAME_EXPORT frame_export;
+  if (frame_export.Init(path, CHECK_BUFFERS))
+  {
+    std::cout << "Failed to initialise frame export" << std::endl;
+    return -2;
+  }
+  MEMFD_PRODUCER producer;
+  if (producer.Init(CHECK_WIDTH, CHECK_HEIGHT, CHECK_BUFFERS))
+  {
+    std::cout << "Failed to initialise memfd producer" << std::endl;
+    return -3;
+  }
+  std::atomic<bool> running = true;
+  std::thread thread([&frame_export, &producer, &running]()
+  {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (running)
+    {
+      if (frame_export.HasSubscribers())
+      {
+        producer.Produce(frame_export, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  });
+  const int ret = Subscribe(path, true);
+  running = false;
+  thread.join();
+  // Subscribers hand buffers back to the producer, so they must all be gone before it is
+  frame_export.Destroy();
+  std::cout << "Produced " << producer.GetProduced() << " frames, starved " << producer.GetStarved() << std::endl;
+  return (ret == 0) ? 0 : -4;
+}
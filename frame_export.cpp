@@ -0,0 +1,375 @@
+#include "frame_export.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+FRAME_EXPORT::FRAME_EXPORT()
+  : listen_fd_(-1)
+  , wake_fd_(-1)
+  , max_outstanding_(0)
+  , next_id_(0)
+  , subscribers_count_(0)
+  , sent_(0)
+  , skipped_(0)
+{
+}
+
+FRAME_EXPORT::~FRAME_EXPORT()
+{
+  Destroy();
+}
+
+int FRAME_EXPORT::Init(const std::string& path, const unsigned int max_outstanding)
+{
+  Destroy();
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  if (path.empty() || (path.size() >= sizeof(address.sun_path)))
+  {
+    std::cout << "Invalid export socket path: " << path << std::endl;
+    return -1;
+  }
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  listen_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd_ == -1)
+  {
+    std::cout << "Failed to create export socket" << std::endl;
+    return -2;
+  }
+  unlink(path.c_str()); // Remove any stale socket left behind by a previous run
+  if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)))
+  {
+    std::cout << "Failed to bind export socket: " << path << std::endl;
+    Destroy();
+    return -3;
+  }
+  path_ = path;
+  if (listen(listen_fd_, 16))
+  {
+    std::cout << "Failed to listen on export socket: " << path << std::endl;
+    Destroy();
+    return -4;
+  }
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd_ == -1)
+  {
+    std::cout << "Failed to create export event" << std::endl;
+    Destroy();
+    return -5;
+  }
+  max_outstanding_ = max_outstanding;
+  thread_ = std::thread([this](){ Run(); });
+  return 0;
+}
+
+void FRAME_EXPORT::Destroy()
+{
+  if (thread_.joinable())
+  {
+    const uint64_t wake = 1;
+    if (write(wake_fd_, &wake, sizeof(wake)) != sizeof(wake))
+    {
+      std::cout << "Failed to wake export thread" << std::endl;
+    }
+    thread_.join();
+  }
+  std::vector<std::function<void()>> releases;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::unique_ptr<FRAME_EXPORT_SUBSCRIBER>& subscriber : subscribers_)
+    {
+      Disconnect(*subscriber, releases);
+    }
+    subscribers_.clear();
+    subscribers_count_ = 0;
+    // Anything left is no longer reachable by a subscriber
+    for (std::pair<const uint64_t, EXPORTED_FRAME>& frame : frames_)
+    {
+      releases.push_back(frame.second.release_);
+    }
+    frames_.clear();
+  }
+  for (const std::function<void()>& release : releases)
+  {
+    release();
+  }
+  if (listen_fd_ != -1)
+  {
+    close(listen_fd_);
+    listen_fd_ = -1;
+  }
+  if (wake_fd_ != -1)
+  {
+    close(wake_fd_);
+    wake_fd_ = -1;
+  }
+  if (path_.size())
+  {
+    unlink(path_.c_str());
+    path_.clear();
+  }
+}
+
+void FRAME_EXPORT::Publish(FRAME_EXPORT_FRAME header, const int fd, const std::function<void()>& release)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    header.type_ = FRAME_EXPORT_MESSAGE_FRAME;
+    header.id_ = next_id_++;
+    EXPORTED_FRAME frame(release);
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (std::unique_ptr<FRAME_EXPORT_SUBSCRIBER>& subscriber : subscribers_)
+    {
+      if (!subscriber->subscribed_ || subscriber->closed_)
+      {
+        continue;
+      }
+      // Allow half an interval of jitter so a subscriber asking for exactly half the source rate is not starved by timing noise
+      if ((subscriber->interval_ != std::chrono::steady_clock::duration::zero()) && ((now + (subscriber->interval_ / 2)) < subscriber->next_))
+      {
+        continue;
+      }
+      // Don't let a slow subscriber hold every decoder buffer
+      if (subscriber->outstanding_.size() >= max_outstanding_)
+      {
+        ++subscriber->skipped_;
+        ++skipped_;
+        continue;
+      }
+      iovec iov;
+      iov.iov_base = &header;
+      iov.iov_len = sizeof(header);
+      char control[CMSG_SPACE(sizeof(int))];
+      std::memset(control, 0, sizeof(control));
+      msghdr msg;
+      std::memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+      std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+      if (sendmsg(subscriber->fd_, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(header)))
+      {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        {
+          ++subscriber->skipped_;
+          ++skipped_;
+        }
+        else
+        {
+          // The export thread notices the hang up and cleans the subscriber up
+          subscriber->closed_ = true;
+          --subscribers_count_;
+          shutdown(subscriber->fd_, SHUT_RDWR);
+        }
+        continue;
+      }
+      if (subscriber->interval_ != std::chrono::steady_clock::duration::zero())
+      {
+        // Keep to the schedule unless we have fallen a whole interval behind it
+        subscriber->next_ += subscriber->interval_;
+        if (subscriber->next_ <= now)
+        {
+          subscriber->next_ = now + subscriber->interval_;
+        }
+      }
+      subscriber->outstanding_.insert(header.id_);
+      ++subscriber->sent_;
+      ++sent_;
+      ++frame.references_;
+    }
+    if (frame.references_)
+    {
+      frames_.insert(std::make_pair(header.id_, frame));
+      return;
+    }
+  }
+  release();
+}
+
+size_t FRAME_EXPORT::GetOutstanding()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frames_.size();
+}
+
+void FRAME_EXPORT::Run()
+{
+  std::vector<pollfd> fds;
+  while (true)
+  {
+    fds.clear();
+    fds.push_back({ wake_fd_, POLLIN, 0 });
+    fds.push_back({ listen_fd_, POLLIN, 0 });
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (const std::unique_ptr<FRAME_EXPORT_SUBSCRIBER>& subscriber : subscribers_)
+      {
+        fds.push_back({ subscriber->fd_, POLLIN, 0 });
+      }
+    }
+    if (poll(fds.data(), fds.size(), -1) == -1)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      std::cout << "Failed to poll export socket" << std::endl;
+      return;
+    }
+    if (fds[0].revents)
+    {
+      return;
+    }
+    std::vector<std::function<void()>> releases;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (fds[1].revents & POLLIN)
+      {
+        while (true)
+        {
+          const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+          if (fd == -1)
+          {
+            break;
+          }
+          subscribers_.push_back(std::make_unique<FRAME_EXPORT_SUBSCRIBER>(fd));
+        }
+      }
+      // Subscribers only ever get added by this thread, so the indices still line up with the poll set
+      for (size_t i = 2; i < fds.size(); ++i)
+      {
+        FRAME_EXPORT_SUBSCRIBER& subscriber = *subscribers_[i - 2];
+        if (fds[i].revents & POLLIN)
+        {
+          Receive(subscriber, releases);
+        }
+        if (fds[i].revents & (POLLHUP | POLLERR))
+        {
+          if (!subscriber.closed_ && subscriber.subscribed_)
+          {
+            --subscribers_count_;
+          }
+          subscriber.closed_ = true;
+        }
+      }
+      for (std::vector<std::unique_ptr<FRAME_EXPORT_SUBSCRIBER>>::iterator subscriber = subscribers_.begin(); subscriber != subscribers_.end();)
+      {
+        if ((*subscriber)->closed_)
+        {
+          Disconnect(**subscriber, releases);
+          subscriber = subscribers_.erase(subscriber);
+        }
+        else
+        {
+          ++subscriber;
+        }
+      }
+    }
+    for (const std::function<void()>& release : releases)
+    {
+      release();
+    }
+  }
+}
+
+void FRAME_EXPORT::Receive(FRAME_EXPORT_SUBSCRIBER& subscriber, std::vector<std::function<void()>>& releases)
+{
+  while (!subscriber.closed_)
+  {
+    uint8_t buffer[64];
+    const ssize_t size = recv(subscriber.fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (size < 0)
+    {
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+      {
+        if (subscriber.subscribed_)
+        {
+          --subscribers_count_;
+        }
+        subscriber.closed_ = true;
+      }
+      return;
+    }
+    if (size == 0)
+    {
+      if (subscriber.subscribed_)
+      {
+        --subscribers_count_;
+      }
+      subscriber.closed_ = true;
+      return;
+    }
+    if (static_cast<size_t>(size) < sizeof(uint32_t))
+    {
+      continue;
+    }
+    uint32_t type = 0;
+    std::memcpy(&type, buffer, sizeof(type));
+    if ((type == FRAME_EXPORT_MESSAGE_SUBSCRIBE) && (static_cast<size_t>(size) >= sizeof(FRAME_EXPORT_SUBSCRIBE)))
+    {
+      FRAME_EXPORT_SUBSCRIBE subscribe;
+      std::memcpy(&subscribe, buffer, sizeof(subscribe));
+      if (!subscriber.subscribed_)
+      {
+        ++subscribers_count_;
+      }
+      subscriber.subscribed_ = true;
+      subscriber.interval_ = subscribe.max_fps_ ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)) / subscribe.max_fps_ : std::chrono::steady_clock::duration::zero();
+      subscriber.next_ = std::chrono::steady_clock::time_point();
+    }
+    else if ((type == FRAME_EXPORT_MESSAGE_RELEASE) && (static_cast<size_t>(size) >= sizeof(FRAME_EXPORT_RELEASE)))
+    {
+      FRAME_EXPORT_RELEASE release;
+      std::memcpy(&release, buffer, sizeof(release));
+      if (subscriber.outstanding_.erase(release.id_))
+      {
+        Release(release.id_, releases);
+      }
+    }
+    else
+    {
+      std::cout << "Invalid export message: " << type << std::endl;
+    }
+  }
+}
+
+void FRAME_EXPORT::Release(const uint64_t id, std::vector<std::function<void()>>& releases)
+{
+  std::map<uint64_t, EXPORTED_FRAME>::iterator frame = frames_.find(id);
+  if (frame == frames_.end())
+  {
+    return;
+  }
+  if (--frame->second.references_ == 0)
+  {
+    releases.push_back(frame->second.release_);
+    frames_.erase(frame);
+  }
+}
+
+void FRAME_EXPORT::Disconnect(FRAME_EXPORT_SUBSCRIBER& subscriber, std::vector<std::function<void()>>& releases)
+{
+  // A subscriber that goes away implicitly returns everything it held
+  for (const uint64_t id : subscriber.outstanding_)
+  {
+    Release(id, releases);
+  }
+  subscriber.outstanding_.clear();
+  if (subscriber.fd_ != -1)
+  {
+    close(subscriber.fd_);
+    subscriber.fd_ = -1;
+  }
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Wire format for the SOCK_SEQPACKET export socket, every message starts with its type
+// Subscribers send FRAME_EXPORT_SUBSCRIBE once, then receive FRAME_EXPORT_FRAME messages each carrying a dma-buf fd as SCM_RIGHTS
+// Every frame must be returned with FRAME_EXPORT_RELEASE, the decoder does not reuse the buffer until all subscribers have done so
+// The fd is a new descriptor each time, subscribers close it once they have imported or finished with it
+enum FRAME_EXPORT_MESSAGE_TYPE : uint32_t
+{
+  FRAME_EXPORT_MESSAGE_SUBSCRIBE = 1,
+  FRAME_EXPORT_MESSAGE_FRAME = 2,
+  FRAME_EXPORT_MESSAGE_RELEASE = 3
+};
+
+const size_t FRAME_EXPORT_MAX_PLANES = 3;
+
+// Colour values are MPP's, which follow H.273 the same as FFmpeg's, so subscribers need nothing from Rockchip to read them
+const uint32_t FRAME_EXPORT_COLOUR_SPACE_BT709 = 1;
+const uint32_t FRAME_EXPORT_COLOUR_SPACE_BT601 = 6;
+const uint32_t FRAME_EXPORT_COLOUR_SPACE_BT2020 = 9;
+const uint32_t FRAME_EXPORT_COLOUR_RANGE_LIMITED = 1;
+const uint32_t FRAME_EXPORT_COLOUR_RANGE_FULL = 2;
+const uint32_t FRAME_EXPORT_COLOUR_PRIMARIES_BT709 = 1;
+
+struct FRAME_EXPORT_SUBSCRIBE
+{
+  uint32_t type_;
+  uint32_t max_fps_; // 0 receives every frame
+};
+
+struct FRAME_EXPORT_PLANE
+{
+  uint32_t offset_;
+  uint32_t pitch_;
+};
+
+struct FRAME_EXPORT_FRAME
+{
+  uint32_t type_;
+  uint32_t stream_;
+  uint64_t id_;
+  int64_t pts_;
+  int32_t time_base_num_;
+  int32_t time_base_den_;
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t crop_x_;
+  uint32_t crop_y_;
+  uint32_t drm_format_;
+  uint32_t plane_count_;
+  FRAME_EXPORT_PLANE planes_[FRAME_EXPORT_MAX_PLANES];
+  uint64_t size_;
+  uint32_t colour_space_; // FRAME_EXPORT_COLOUR_SPACE_*, or any other MppFrameColorSpace
+  uint32_t colour_range_; // FRAME_EXPORT_COLOUR_RANGE_*
+  uint32_t colour_primaries_; // FRAME_EXPORT_COLOUR_PRIMARIES_*, or any other MppFrameColorPrimaries
+  uint32_t reserved_;
+};
+
+struct FRAME_EXPORT_RELEASE
+{
+  uint32_t type_;
+  uint32_t reserved_;
+  uint64_t id_;
+};
+
+struct EXPORTED_FRAME
+{
+  EXPORTED_FRAME(const std::function<void()>& release)
+    : release_(release)
+    , references_(0)
+  {
+  }
+
+  std::function<void()> release_;
+  unsigned int references_;
+
+};
+
+struct FRAME_EXPORT_SUBSCRIBER
+{
+  FRAME_EXPORT_SUBSCRIBER(const int fd)
+    : fd_(fd)
+    , subscribed_(false)
+    , closed_(false)
+    , interval_(std::chrono::steady_clock::duration::zero())
+    , sent_(0)
+    , skipped_(0)
+  {
+  }
+
+  int fd_;
+  bool subscribed_;
+  bool closed_;
+  std::chrono::steady_clock::duration interval_;
+  std::chrono::steady_clock::time_point next_;
+  std::set<uint64_t> outstanding_;
+  uint64_t sent_;
+  uint64_t skipped_;
+
+};
+
+// Publishes decoded frames to other processes over a Unix domain socket without copying them
+class FRAME_EXPORT
+{
+ public:
+
+  FRAME_EXPORT();
+  ~FRAME_EXPORT();
+
+  int Init(const std::string& path, const unsigned int max_outstanding);
+  void Destroy();
+
+  bool HasSubscribers() const { return (subscribers_count_ > 0); }
+  // The release function is always called exactly once, either immediately when no subscriber took the frame or when the last subscriber returns it
+  void Publish(FRAME_EXPORT_FRAME header, const int fd, const std::function<void()>& release);
+
+  unsigned int GetSubscribers() const { return subscribers_count_; }
+  uint64_t GetSent() const { return sent_; }
+  uint64_t GetSkipped() const { return skipped_; }
+  size_t GetOutstanding();
+
+ private:
+
+  void Run();
+  void Receive(FRAME_EXPORT_SUBSCRIBER& subscriber, std::vector<std::function<void()>>& releases);
+  void Release(const uint64_t id, std::vector<std::function<void()>>& releases);
+  void Disconnect(FRAME_EXPORT_SUBSCRIBER& subscriber, std::vector<std::function<void()>>& releases);
+
+  std::string path_;
+  int listen_fd_;
+  int wake_fd_;
+  unsigned int max_outstanding_;
+  uint64_t next_id_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<FRAME_EXPORT_SUBSCRIBER>> subscribers_;
+  std::map<uint64_t, EXPORTED_FRAME> frames_;
+
+  std::atomic<unsigned int> subscribers_count_;
+  std::atomic<uint64_t> sent_;
+  std::atomic<uint64_t> skipped_;
+
+};
@@ -0,0 +1,56 @@
+#include "gl.hpp"
+
+#include <exception>
+#include <iostream>
+
+void GLCheckError(const char* stmt, const char* filename, const int line)
+{
+  int count = 0; // Just in case we recursively create errors we need to stop
+  while (true)
+  {
+    const GLenum err = glGetError();
+    if (err == GL_NO_ERROR)
+    {
+      return;
+    }
+    if (++count >= 20)
+    {
+      std::terminate();
+    }
+  }
+}
+
+// Recreates the frame buffer if the size has changed and leaves it bound
+int BindFrameBuffer(std::unique_ptr<FRAME_BUFFER>& frame_buffer, const GLsizei width, const GLsizei height)
+{
+  if (frame_buffer && ((frame_buffer->width_ != width) || (frame_buffer->height_ != height)))
+  {
+    frame_buffer.reset();
+  }
+  if (frame_buffer)
+  {
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer->frame_));
+    return 0;
+  }
+  GLuint frame = GL_INVALID_VALUE;
+  GL_CHECK(glGenFramebuffers(1, &frame));
+  GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, frame));
+  GLuint frame_buffer_texture = GL_INVALID_VALUE;
+  GL_CHECK(glGenTextures(1, &frame_buffer_texture));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, frame_buffer_texture));
+  GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE)); // Cropped and zoomed views sample right up to the edge
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+  GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame_buffer_texture, 0));
+  frame_buffer = std::make_unique<FRAME_BUFFER>(frame, frame_buffer_texture, width, height);
+  if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+  {
+    std::cout << "Failed to create frame buffer" << std::endl;
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    frame_buffer.reset();
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <GLES3/gl3.h>
+#include <memory>
+
+#define GL_CHECK(stmt) stmt; GLCheckError(#stmt, __FILE__, __LINE__);
+
+void GLCheckError(const char* stmt, const char* filename, const int line);
+
+struct FRAME_BUFFER
+{
+  FRAME_BUFFER(const GLuint frame, const GLuint texture, const GLsizei width, const GLsizei height)
+    : frame_(frame)
+    , texture_(texture)
+    , width_(width)
+    , height_(height)
+  {
+  }
+
+  ~FRAME_BUFFER()
+  {
+    glDeleteFramebuffers(1, &frame_);
+    glDeleteTextures(1, &texture_);
+  }
+
+  size_t GetBytes() const { return static_cast<size_t>(width_) * static_cast<size_t>(height_) * 4; } // RGBA8
+
+  GLuint frame_;
+  GLuint texture_;
+  GLsizei width_;
+  GLsizei height_;
+
+};
+
+// Recreates the frame buffer if the size has changed and leaves it bound
+int BindFrameBuffer(std::unique_ptr<FRAME_BUFFER>& frame_buffer, const GLsizei width, const GLsizei height);
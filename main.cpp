@@ -4,8 +4,11 @@
 
 #include <arpa/inet.h>
 #include <atomic>
+#include <boost/algorithm/string.hpp>
 #include <boost/optional.hpp>
 #include <boost/scope_exit.hpp>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <drm/drm_fourcc.h>
 #include <EGL/egl.h>
@@ -53,51 +56,58 @@ extern "C"
 #include <libswscale/swscale.h>
 }
 
-#define GL_CHECK(stmt) stmt; GLCheckError(#stmt, __FILE__, __LINE__);
+#include "benchmark.hpp"
+#include "colour.hpp"
+#include "display.hpp"
+#include "egl_image.hpp"
+#include "frame_export.hpp"
+#include "gl.hpp"
+#include "memfd_producer.hpp"
+#include "memory.hpp"
+#include "mosaic.hpp"
+#include "mpp_decoder.hpp"
+#include "overlay.hpp"
+#include "recorder.hpp"
+#include "recovery.hpp"
+#include "rga_scaler.hpp"
+#include "scaler.hpp"
+#include "snapshot.hpp"
+#include "software_decoder.hpp"
+#include "texture_upload.hpp"
 
-struct FRAME_BUFFER
+enum class SCALER_TYPE
 {
-  FRAME_BUFFER(const GLuint frame, const GLuint texture, const GLsizei width, const GLsizei height)
-    : frame_(frame)
-    , texture_(texture)
-    , width_(width)
-    , height_(height)
-  {
-  }
-
-  ~FRAME_BUFFER()
-  {
-    glDeleteFramebuffers(1, &frame_);
-    glDeleteTextures(1, &texture_);
-  }
-
-  GLuint frame_;
-  GLuint texture_;
-  GLsizei width_;
-  GLsizei height_;
-
+  NONE,
+  RGA,
+  SOFTWARE
 };
 
+// Either image_ holds the whole frame, or luma_image_ and chroma_image_ hold the planes for shader colour conversion
 struct EGL_FRAME
 {
-  EGL_FRAME(const EGLImageKHR image, const MppFrameColorSpace colour_space, const MppFrameColorRange colour_range, const RK_U32 width, const RK_U32 height)
+  EGL_FRAME(const EGLImageKHR image, const EGLImageKHR luma_image, const EGLImageKHR chroma_image, const MppFrameColorSpace colour_space, const MppFrameColorRange colour_range, const RK_U32 width, const RK_U32 height, const size_t size)
     : image_(image)
+    , luma_image_(luma_image)
+    , chroma_image_(chroma_image)
     , colour_space_(colour_space)
     , colour_range_(colour_range)
     , width_(width)
     , height_(height)
+    , size_(size)
   {
   }
 
   EGLImageKHR image_;
+  EGLImageKHR luma_image_;
+  EGLImageKHR chroma_image_;
   MppFrameColorSpace colour_space_;
   MppFrameColorRange colour_range_;
   RK_U32 width_;
   RK_U32 height_;
+  size_t size_; // Of the dma-buf the images keep hold of
 
 };
 
-const uint8_t H264_START_SEQUENCE[] = { 0, 0, 0, 1 };
 const std::string GLSL_VERSION_STRING("#version 320 es");
 const std::string vertex_shader = GLSL_VERSION_STRING + "\n"
                                   "#undef lowp\n#undef mediump\n#undef highp\nprecision mediump float;\n"
@@ -109,6 +119,19 @@ const std::string vertex_shader = GLSL_VERSION_STRING + "\n"
                                   "  gl_Position = vec4(position, 0.0, 1.0);\n"
                                   "  outtexcoord = vec2(texcoord.x, texcoord.y);\n"
                                   "}";
+// The display pass letterboxes, crops and zooms by transforming the quad and its texture coordinates
+const std::string display_vertex_shader = GLSL_VERSION_STRING + "\n"
+                                          "#undef lowp\n#undef mediump\n#undef highp\nprecision highp float;\n"
+                                          "in vec2 position;\n"
+                                          "in vec2 texcoord;\n"
+                                          "out vec2 outtexcoord;\n"
+                                          "uniform vec4 position_transform;\n"
+                                          "uniform vec4 texcoord_transform;\n"
+                                          "void main()\n"
+                                          "{\n"
+                                          "  gl_Position = vec4((position * position_transform.xy) + position_transform.zw, 0.0, 1.0);\n"
+                                          "  outtexcoord = (texcoord * texcoord_transform.xy) + texcoord_transform.zw;\n"
+                                          "}";
 const std::string oes_fragment_shader = GLSL_VERSION_STRING + "\n"
                                         "#extension GL_OES_EGL_image_external : require\n"
                                         "#undef lowp\n#undef mediump\n#undef highp\nprecision mediump float;\n"
@@ -128,6 +151,33 @@ const std::string fragment_shader = GLSL_VERSION_STRING + "\n"
                                     "{\n"
                                     "  colour = texture(tex, outtexcoord.st);\n"
                                     "}";
+const std::string nv12_fragment_shader = GLSL_VERSION_STRING + "\n"
+                                         "#undef lowp\n#undef mediump\n#undef highp\nprecision highp float;\n"
+                                         "in vec2 outtexcoord;\n"
+                                         "out vec4 colour;\n"
+                                         "uniform sampler2D luma;\n"
+                                         "uniform sampler2D chroma;\n"
+                                         "uniform mat3 yuv_matrix;\n"
+                                         "uniform vec3 yuv_offset;\n"
+                                         "void main()\n"
+                                         "{\n"
+                                         "  vec3 yuv = vec3(texture(luma, outtexcoord.st).r, texture(chroma, outtexcoord.st).rg) - yuv_offset;\n"
+                                         "  colour = vec4(clamp(yuv_matrix * yuv, 0.0, 1.0), 1.0);\n"
+                                         "}";
+const std::string yuv420p_fragment_shader = GLSL_VERSION_STRING + "\n"
+                                            "#undef lowp\n#undef mediump\n#undef highp\nprecision highp float;\n"
+                                            "in vec2 outtexcoord;\n"
+                                            "out vec4 colour;\n"
+                                            "uniform sampler2D luma;\n"
+                                            "uniform sampler2D chroma_u;\n"
+                                            "uniform sampler2D chroma_v;\n"
+                                            "uniform mat3 yuv_matrix;\n"
+                                            "uniform vec3 yuv_offset;\n"
+                                            "void main()\n"
+                                            "{\n"
+                                            "  vec3 yuv = vec3(texture(luma, outtexcoord.st).r, texture(chroma_u, outtexcoord.st).r, texture(chroma_v, outtexcoord.st).r) - yuv_offset;\n"
+                                            "  colour = vec4(clamp(yuv_matrix * yuv, 0.0, 1.0), 1.0);\n"
+                                            "}";
 const std::vector<std::pair<MppFrameColorSpace, std::string>> MPP_COLOUR_SPACES =
 {
   std::make_pair(MPP_FRAME_SPC_RGB, "MPP_FRAME_SPC_RGB"),
@@ -177,6 +227,38 @@ const std::vector<std::pair<int, std::string>> EGL_COLOUR_RANGES =
   std::make_pair(EGL_YUV_FULL_RANGE_EXT, "EGL_YUV_FULL_RANGE_EXT"),
   std::make_pair(EGL_YUV_NARROW_RANGE_EXT, "EGL_YUV_NARROW_RANGE_EXT")
 };
+const std::vector<std::pair<SNAPSHOT_FORMAT, std::string>> SNAPSHOT_FORMATS =
+{
+  std::make_pair(SNAPSHOT_FORMAT::PNG, "PNG"),
+  std::make_pair(SNAPSHOT_FORMAT::JPEG, "JPEG")
+};
+const std::vector<std::pair<RECORDER_FORMAT, std::string>> RECORDER_FORMATS =
+{
+  std::make_pair(RECORDER_FORMAT::MP4, "MP4"),
+  std::make_pair(RECORDER_FORMAT::MKV, "MKV")
+};
+const std::vector<std::pair<DISPLAY_SCALING, std::string>> DISPLAY_SCALINGS =
+{
+  std::make_pair(DISPLAY_SCALING::LETTERBOX, "Letterbox"),
+  std::make_pair(DISPLAY_SCALING::FILL, "Fill"),
+  std::make_pair(DISPLAY_SCALING::STRETCH, "Stretch")
+};
+const std::vector<std::pair<SCALER_TYPE, std::string>> SCALER_TYPES =
+{
+  std::make_pair(SCALER_TYPE::NONE, "None"),
+  std::make_pair(SCALER_TYPE::RGA, "RGA"),
+  std::make_pair(SCALER_TYPE::SOFTWARE, "Software")
+};
+const std::vector<std::pair<SCALER_FORMAT, std::string>> SCALER_FORMATS =
+{
+  std::make_pair(SCALER_FORMAT::NV12, "NV12"),
+  std::make_pair(SCALER_FORMAT::RGBA, "RGBA")
+};
+const std::vector<std::string> COLOUR_CONVERSIONS =
+{
+  "EGL",
+  "Shader"
+};
 std::atomic<bool> running = true;
 
 void sig(const int signum)
@@ -226,109 +308,520 @@ const char* GetColourPrimariesText(const boost::optional<MppFrameColorPrimaries>
   return i->second.c_str();
 }
 
-void GLCheckError(const char* stmt, const char* filename, const int line)
+int CreateShader(GLuint program, GLenum type, const char* source, int size)
+{
+  const GLuint shader = glCreateShader(type);
+  if (shader == 0)
+  {
+    std::cout << "Failed to create shader program" << std::endl;
+    return -1;
+  }
+  GL_CHECK(glShaderSource(shader, 1, &source, &size));
+  GL_CHECK(glCompileShader(shader));
+  int result = GL_FALSE;
+  GL_CHECK(glGetShaderiv(shader, GL_COMPILE_STATUS, &result));
+  if (result != GL_TRUE)
+  {
+    char error_log[1024];
+    std::memset(&error_log[0], 0, sizeof(error_log));
+    GL_CHECK(glGetShaderInfoLog(shader, sizeof(error_log), nullptr, &error_log[0]));
+    std::cout << "Failed to compile shader " << std::endl << source << std::endl << std::endl << error_log << std::endl;
+    GL_CHECK(glDeleteShader(shader));
+    return -2;
+  }
+  GL_CHECK(glAttachShader(program, shader));
+  GL_CHECK(glDeleteShader(shader));
+  return 0;
+}
+
+void DestroyEGLFrames(PFNEGLDESTROYIMAGEKHRPROC egl_destroy_image_khr, std::map<MppBuffer, EGL_FRAME>& egl_images)
+{
+  for (const std::pair<MppBuffer, EGL_FRAME>& egl_image : egl_images)
+  {
+    for (const EGLImageKHR image : { egl_image.second.image_, egl_image.second.luma_image_, egl_image.second.chroma_image_ })
+    {
+      if (image == EGL_NO_IMAGE_KHR)
+      {
+        continue;
+      }
+      if (egl_destroy_image_khr(glfwGetEGLDisplay(), image) != EGL_TRUE)
+      {
+        std::cout << "Failed to destroy EGL image" << std::endl;
+      }
+    }
+  }
+  egl_images.clear();
+}
+
+YUV_COLOUR_SPACE GetMPPYUVColourSpace(const MppFrameColorSpace mpp_colour_space)
 {
-  int count = 0; // Just in case we recursively create errors we need to stop
-  while (true)
+  switch (mpp_colour_space)
   {
-    const GLenum err = glGetError();
-    if (err == GL_NO_ERROR)
+    case MPP_FRAME_SPC_BT709:
+    {
+      return YUV_COLOUR_SPACE::BT709;
+    }
+    case MPP_FRAME_SPC_BT2020_NCL:
+    case MPP_FRAME_SPC_BT2020_CL:
     {
-      return;
+      return YUV_COLOUR_SPACE::BT2020;
     }
-    if (++count >= 20)
+    default:
     {
-      std::terminate();
+      return YUV_COLOUR_SPACE::BT601;
     }
   }
 }
 
-int CopyBuffer(const uint8_t* ptr, const size_t size, MppPacket& packet, std::unique_ptr<char[]>& packet_buffer, size_t& packet_buffer_size)
+YUV_COLOUR_SPACE GetYUVColourSpace(const int egl_colour_space)
 {
-  const size_t nal_size = size + sizeof(H264_START_SEQUENCE);
-  if ((packet_buffer == nullptr) || (nal_size > packet_buffer_size))
+  switch (egl_colour_space)
   {
-    packet_buffer = std::make_unique<char[]>(nal_size);
-    packet_buffer_size = nal_size;
-    if (mpp_packet_deinit(&packet) != MPP_OK)
+    case EGL_ITU_REC709_EXT:
     {
-      std::cout << "Failed to deinit packet" << std::endl;
-      return -1;
+      return YUV_COLOUR_SPACE::BT709;
     }
-    if (mpp_packet_init(&packet, packet_buffer.get(), packet_buffer_size) != MPP_OK)
+    case EGL_ITU_REC2020_EXT:
     {
-      std::cout << "Failed to init packet" << std::endl;
-      return -2;
+      return YUV_COLOUR_SPACE::BT2020;
+    }
+    default:
+    {
+      return YUV_COLOUR_SPACE::BT601;
     }
   }
-  memcpy(packet_buffer.get(), H264_START_SEQUENCE, sizeof(H264_START_SEQUENCE));
-  memcpy(packet_buffer.get() + 4, ptr, size);
-  mpp_packet_write(packet, 0, packet_buffer.get(), nal_size);
-  mpp_packet_set_pos(packet, packet_buffer.get());
-  mpp_packet_set_length(packet, nal_size);
-  return 0;
 }
 
-int SendFrame(MppApi* api, MppCtx context, const uint8_t* ptr, const size_t size, MppPacket& packet, std::unique_ptr<char[]>& packet_buffer, size_t& packet_buffer_size)
+int VerifyYUVShader(const GLuint program, const GLuint vao, const GLint luma_location, const GLint chroma_location, const GLint matrix_location, const GLint offset_location, const YUV_MATRIX& yuv_matrix, int& max_error)
 {
-  if (CopyBuffer(ptr, size, packet, packet_buffer, packet_buffer_size))
+  // Draw a known pattern through the shader and compare every pixel with the CPU reference
+  const GLsizei size = 16;
+  std::vector<uint8_t> luma(size * size);
+  std::vector<uint8_t> chroma((size / 2) * (size / 2) * 2);
+  for (GLsizei y = 0; y < size; ++y)
+  {
+    for (GLsizei x = 0; x < size; ++x)
+    {
+      luma[(y * size) + x] = static_cast<uint8_t>(((y * size) + x) * 255 / ((size * size) - 1));
+    }
+  }
+  for (GLsizei y = 0; y < (size / 2); ++y)
   {
-    std::cout << "Failed to copy buffer" << std::endl;
+    for (GLsizei x = 0; x < (size / 2); ++x)
+    {
+      chroma[((y * (size / 2)) + x) * 2] = static_cast<uint8_t>(x * 255 / ((size / 2) - 1));
+      chroma[(((y * (size / 2)) + x) * 2) + 1] = static_cast<uint8_t>(255 - (y * 255 / ((size / 2) - 1)));
+    }
+  }
+  GLuint textures[2] = { 0, 0 };
+  GL_CHECK(glGenTextures(2, textures));
+  BOOST_SCOPE_EXIT(&textures)
+  {
+    GL_CHECK(glDeleteTextures(2, textures));
+  }
+  BOOST_SCOPE_EXIT_END
+  GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+  GL_CHECK(glActiveTexture(GL_TEXTURE1));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, textures[1]));
+  GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, size / 2, size / 2, 0, GL_RG, GL_UNSIGNED_BYTE, chroma.data()));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+  GL_CHECK(glActiveTexture(GL_TEXTURE0));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, textures[0]));
+  GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, size, size, 0, GL_RED, GL_UNSIGNED_BYTE, luma.data()));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+  GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+  FRAME_BUFFER frame_buffer(GL_INVALID_VALUE, GL_INVALID_VALUE, size, size);
+  GL_CHECK(glGenFramebuffers(1, &frame_buffer.frame_));
+  GL_CHECK(glGenTextures(1, &frame_buffer.texture_));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, frame_buffer.texture_));
+  GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+  GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer.frame_));
+  GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame_buffer.texture_, 0));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, textures[0]));
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+  {
+    std::cout << "Failed to create verification frame buffer" << std::endl;
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
     return -1;
   }
-  const int ret = api->decode_put_packet(context, packet);
-  if (ret != MPP_OK)
+  GL_CHECK(glViewport(0, 0, size, size));
+  GL_CHECK(glUseProgram(program));
+  GL_CHECK(glUniform1i(luma_location, 0));
+  GL_CHECK(glUniform1i(chroma_location, 1));
+  GL_CHECK(glUniformMatrix3fv(matrix_location, 1, GL_FALSE, yuv_matrix.matrix_));
+  GL_CHECK(glUniform3fv(offset_location, 1, yuv_matrix.offset_));
+  GL_CHECK(glBindVertexArray(vao));
+  GL_CHECK(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
+  GL_CHECK(glBindVertexArray(0));
+  GL_CHECK(glUseProgram(0));
+  // Synchronous, but this only happens when asked for
+  std::vector<uint8_t> pixels(size * size * 4);
+  GL_CHECK(glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+  GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+  GL_CHECK(glActiveTexture(GL_TEXTURE1));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+  GL_CHECK(glActiveTexture(GL_TEXTURE0));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+  max_error = 0;
+  for (GLsizei y = 0; y < size; ++y)
   {
-    std::cout << "Failed to place packet: " << ret << std::endl;
-    return -2;
+    for (GLsizei x = 0; x < size; ++x)
+    {
+      const size_t c = (((y / 2) * (size / 2)) + (x / 2)) * 2;
+      uint8_t rgb[3];
+      YUVToRGB(yuv_matrix, luma[(y * size) + x], chroma[c], chroma[c + 1], rgb);
+      for (int i = 0; i < 3; ++i)
+      {
+        max_error = std::max(max_error, std::abs(static_cast<int>(pixels[(((y * size) + x) * 4) + i]) - static_cast<int>(rgb[i])));
+      }
+    }
   }
   return 0;
 }
 
-int CreateShader(GLuint program, GLenum type, const char* source, int size)
+std::unique_ptr<SCALER> CreateScaler(const SCALER_TYPE type)
 {
-  const GLuint shader = glCreateShader(type);
-  if (shader == 0)
+  switch (type)
   {
-    std::cout << "Failed to create shader program" << std::endl;
+    case SCALER_TYPE::RGA:
+    {
+      return std::make_unique<RGA_SCALER>();
+    }
+    case SCALER_TYPE::SOFTWARE:
+    {
+      return std::make_unique<SWS_SCALER>();
+    }
+    default:
+    {
+      return nullptr;
+    }
+  }
+}
+
+int RunExportStandIn(FRAME_EXPORT& frame_export)
+{
+  MEMFD_PRODUCER producer;
+  if (producer.Init(1920, 1080, 8))
+  {
+    std::cout << "Failed to initialise memfd producer" << std::endl;
     return -1;
   }
-  GL_CHECK(glShaderSource(shader, 1, &source, &size));
-  GL_CHECK(glCompileShader(shader));
-  int result = GL_FALSE;
-  GL_CHECK(glGetShaderiv(shader, GL_COMPILE_STATUS, &result));
-  if (result != GL_TRUE)
+  // Subscribers hand buffers back to the producer, so they must all be gone before it is
+  BOOST_SCOPE_EXIT(&frame_export)
   {
-    char error_log[1024];
-    std::memset(&error_log[0], 0, sizeof(error_log));
-    GL_CHECK(glGetShaderInfoLog(shader, sizeof(error_log), nullptr, &error_log[0]));
-    std::cout << "Failed to compile shader " << std::endl << source << std::endl << std::endl << error_log << std::endl;
-    GL_CHECK(glDeleteShader(shader));
-    return -2;
+    frame_export.Destroy();
   }
-  GL_CHECK(glAttachShader(program, shader));
-  GL_CHECK(glDeleteShader(shader));
+  BOOST_SCOPE_EXIT_END
+  std::cout << "Producing stand in frames" << std::endl;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  while (running)
+  {
+    const int64_t pts = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    producer.Produce(frame_export, pts);
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  }
+  std::cout << "Produced " << producer.GetProduced() << " frames, starved " << producer.GetStarved() << ", sent " << frame_export.GetSent() << ", skipped " << frame_export.GetSkipped() << std::endl;
   return 0;
 }
 
-void DestroyEGLFrames(PFNEGLDESTROYIMAGEKHRPROC egl_destroy_image_khr, std::map<MppBuffer, EGL_FRAME>& egl_images)
+void ShowMemory(MEMORY& memory)
 {
-  for (const std::pair<MppBuffer, EGL_FRAME>& egl_image : egl_images)
+  for (size_t category = 0; category < MEMORY_CATEGORY_COUNT; ++category)
+  {
+    const MEMORY_USAGE usage = memory.GetTotal(static_cast<MEMORY_CATEGORY>(category));
+    ImGui::Text("%s: %.1fMB %lu, peak %.1fMB %lu", GetMemoryCategoryText(static_cast<MEMORY_CATEGORY>(category)), usage.bytes_ / (1024.0 * 1024.0), usage.count_, usage.peak_bytes_ / (1024.0 * 1024.0), usage.peak_count_);
+  }
+  if (memory.GetLimit())
+  {
+    ImGui::Text("Memory: %.1fMB, peak %.1fMB, limit %.1fMB, %lu refused", memory.GetTotalBytes() / (1024.0 * 1024.0), memory.GetPeakBytes() / (1024.0 * 1024.0), memory.GetLimit() / (1024.0 * 1024.0), memory.GetRefused());
+  }
+  else
+  {
+    ImGui::Text("Memory: %.1fMB, peak %.1fMB", memory.GetTotalBytes() / (1024.0 * 1024.0), memory.GetPeakBytes() / (1024.0 * 1024.0));
+  }
+  for (const MEMORY_STREAM& stream : memory.GetStreams())
+  {
+    ImGui::Text("%s: %.1fMB", stream.name_.c_str(), stream.GetBytes() / (1024.0 * 1024.0));
+  }
+}
+
+void PrintMemory(MEMORY& memory)
+{
+  for (size_t category = 0; category < MEMORY_CATEGORY_COUNT; ++category)
+  {
+    const MEMORY_USAGE usage = memory.GetTotal(static_cast<MEMORY_CATEGORY>(category));
+    std::cout << GetMemoryCategoryText(static_cast<MEMORY_CATEGORY>(category)) << " peak " << (usage.peak_bytes_ / (1024 * 1024)) << "MB " << usage.peak_count_ << std::endl;
+  }
+  std::cout << "Memory peak " << (memory.GetPeakBytes() / (1024 * 1024)) << "MB, " << memory.GetRefused() << " streams refused" << std::endl;
+}
+
+int RunMosaic(GLFWwindow* window, DISPLAY_WINDOW& windowed, const std::vector<std::vector<std::string>>& tiles, MEMORY& memory, OVERLAY& overlay, const bool kiosk, const GLuint oes_shader_program, const GLint oes_texture_sampler_location, const GLuint shader_program, const GLint texture_sampler_location, const GLuint vao)
+{
+  MOSAIC mosaic;
+  if (mosaic.Init(tiles, memory, oes_shader_program, oes_texture_sampler_location, vao))
+  {
+    std::cout << "Failed to initialise mosaic" << std::endl;
+    return -1;
+  }
+  std::cout << "Starting mosaic" << std::endl;
+  boost::optional<size_t> maximised;
+  bool show_window = !kiosk;
+  bool fullscreen_key = false;
+  double frame_time = 0.0;
+  while (!glfwWindowShouldClose(window) && running)
   {
-    if (egl_destroy_image_khr(glfwGetEGLDisplay(), egl_image.second.image_) != EGL_TRUE)
+    const std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+    // Poll events
+    glfwPollEvents();
+    // F11 toggles fullscreen, which works in kiosk mode too
+    const bool fullscreen_key_down = (glfwGetKey(window, GLFW_KEY_F11) == GLFW_PRESS);
+    if (fullscreen_key_down && !fullscreen_key && SetFullscreen(window, glfwGetWindowMonitor(window) == nullptr, windowed))
+    {
+      std::cout << "Failed to toggle fullscreen" << std::endl;
+    }
+    fullscreen_key = fullscreen_key_down;
+    int window_width = 0;
+    int window_height = 0;
+    glfwGetFramebufferSize(window, &window_width, &window_height);
+    // Pick sources for the tile sizes, then decode and draw whatever is due
+    if (mosaic.Layout(window_width, window_height, maximised))
+    {
+      std::cout << "Failed to layout mosaic" << std::endl;
+      return -2;
+    }
+    if (mosaic.Update())
+    {
+      std::cout << "Failed to update mosaic" << std::endl;
+      return -3;
+    }
+    // ImGui, which also tracks the mouse for us, so kiosk mode has no interaction at all
+    if (!kiosk && overlay.Begin(window_width, window_height))
+    {
+      ImGui_ImplOpenGL3_NewFrame();
+      ImGui_ImplGlfw_NewFrame();
+      ImGui::NewFrame();
+      if (!ImGui::GetIO().WantCaptureMouse && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left))
+      {
+        // Double clicking a tile maximises it, and double clicking again goes back to the grid
+        if (maximised.is_initialized())
+        {
+          maximised = boost::none;
+        }
+        else
+        {
+          const ImVec2 mouse = ImGui::GetIO().MousePos;
+          const ImVec2 scale = ImGui::GetIO().DisplayFramebufferScale;
+          maximised = mosaic.GetTileAt(static_cast<int>(mouse.x * scale.x), static_cast<int>(mouse.y * scale.y));
+        }
+      }
+      if (show_window)
+      {
+        ImGui::Begin("Controller", &show_window, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoResize);
+        double total_pixel_rate = 0.0;
+        double total_saved_pixel_rate = 0.0;
+        for (size_t i = 0; i < mosaic.GetTiles().size(); ++i)
+        {
+          const MOSAIC_TILE& tile = *mosaic.GetTiles()[i];
+          if (tile.active_ == nullptr)
+          {
+            ImGui::Text("Tile %zu: %dx%d waiting for memory", i, tile.width_, tile.height_);
+            continue;
+          }
+          const MOSAIC_SOURCE& source = tile.sources_[tile.active_->source_];
+          ImGui::Text("Tile %zu: %dx%d decoding %ux%u%s, saving %.1fMpx/s, %lu switches, %lu errors, %lu resets", i, tile.width_, tile.height_, source.width_, source.height_, tile.pending_ ? " (switching)" : "", mosaic.GetSavedPixelRate(tile) / 1000000.0, tile.switches_, tile.errors_, tile.resets_);
+          total_pixel_rate += mosaic.GetPixelRate(tile);
+          total_saved_pixel_rate += mosaic.GetSavedPixelRate(tile);
+        }
+        ImGui::Separator();
+        ImGui::Text("Decoding %.1fMpx/s, saving %.1fMpx/s", total_pixel_rate / 1000000.0, total_saved_pixel_rate / 1000000.0);
+        ImGui::Separator();
+        ShowMemory(memory);
+        ImGui::Separator();
+        ImGui::Text("Frame: %.2fms, overlay %.2fms, %lu rendered, %lu cached", frame_time, overlay.GetRenderTime(), overlay.GetRendered(), overlay.GetCached());
+        ImGui::End();
+      }
+      ImGui::EndFrame();
+      // ImGui Render
+      ImGui::Render();
+      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+      overlay.End();
+    }
+    // Draw the tiles and the overlay in one pass
+    GL_CHECK(glViewport(0, 0, window_width, window_height));
+    GL_CHECK(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+    GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
+    mosaic.Draw(shader_program, texture_sampler_location, window_height);
+    GL_CHECK(glViewport(0, 0, window_width, window_height));
+    if (show_window)
     {
-      std::cout << "Failed to destroy EGL image" << std::endl;
+      overlay.Draw(shader_program, texture_sampler_location, vao);
     }
+    const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
+    frame_time = (frame_time == 0.0) ? elapsed : ((frame_time * 0.9) + (elapsed * 0.1));
+    // Display render
+    glfwSwapBuffers(window);
+    // Delay loop
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
   }
-  egl_images.clear();
+  std::cout << "Frame time " << frame_time << "ms, overlay " << overlay.GetRendered() << " rendered " << overlay.GetCached() << " cached" << std::endl;
+  PrintMemory(memory);
+  mosaic.Destroy();
+  return 0;
 }
 
 int main(int argc, char** argv)
 {
   // Args
-  if (argc < 2)
+  std::string path;
+  std::string export_path;
+  bool export_stand_in = false;
+  int scaler_index = 0;
+  bool shader_colour = false;
+  bool software = false;
+  std::vector<std::vector<std::string>> mosaic_tiles;
+  bool mosaic = false;
+  int recorder_format_index = 0;
+  double record_pre_event = 10.0;
+  size_t record_budget = 32;
+  double record_segment = 60.0;
+  bool record = false;
+  std::string benchmark_manifest;
+  std::string benchmark_report = "benchmark.csv";
+  std::string benchmark_baseline;
+  double benchmark_threshold = 10.0;
+  bool kiosk = false;
+  unsigned int overlay_refresh = 500;
+  bool fullscreen = false;
+  int display_scaling_index = 0;
+  uint64_t memory_limit = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg(argv[i]);
+    if ((arg == "--export") && ((i + 1) < argc))
+    {
+      export_path = argv[++i];
+    }
+    else if ((arg == "--scaler") && ((i + 1) < argc))
+    {
+      const std::string scaler(argv[++i]);
+      std::vector<std::pair<SCALER_TYPE, std::string>>::const_iterator s = std::find_if(SCALER_TYPES.cbegin(), SCALER_TYPES.cend(), [&scaler](const std::pair<SCALER_TYPE, std::string>& s){ return (strcasecmp(s.second.c_str(), scaler.c_str()) == 0); });
+      if (s == SCALER_TYPES.cend())
+      {
+        std::cout << "Invalid scaler: " << scaler << std::endl;
+        return -1;
+      }
+      scaler_index = std::distance(SCALER_TYPES.cbegin(), s);
+    }
+    else if ((arg == "--record-format") && ((i + 1) < argc))
+    {
+      const std::string format(argv[++i]);
+      std::vector<std::pair<RECORDER_FORMAT, std::string>>::const_iterator f = std::find_if(RECORDER_FORMATS.cbegin(), RECORDER_FORMATS.cend(), [&format](const std::pair<RECORDER_FORMAT, std::string>& f){ return (strcasecmp(f.second.c_str(), format.c_str()) == 0); });
+      if (f == RECORDER_FORMATS.cend())
+      {
+        std::cout << "Invalid record format: " << format << std::endl;
+        return -1;
+      }
+      recorder_format_index = std::distance(RECORDER_FORMATS.cbegin(), f);
+    }
+    else if ((arg == "--record-pre-event") && ((i + 1) < argc))
+    {
+      record_pre_event = std::atof(argv[++i]);
+    }
+    else if ((arg == "--record-budget") && ((i + 1) < argc))
+    {
+      record_budget = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if ((arg == "--record-segment") && ((i + 1) < argc))
+    {
+      record_segment = std::atof(argv[++i]);
+    }
+    else if ((arg == "--benchmark") && ((i + 1) < argc))
+    {
+      benchmark_manifest = argv[++i];
+    }
+    else if ((arg == "--benchmark-report") && ((i + 1) < argc))
+    {
+      benchmark_report = argv[++i];
+    }
+    else if ((arg == "--benchmark-baseline") && ((i + 1) < argc))
+    {
+      benchmark_baseline = argv[++i];
+    }
+    else if ((arg == "--benchmark-threshold") && ((i + 1) < argc))
+    {
+      benchmark_threshold = std::atof(argv[++i]);
+    }
+    else if ((arg == "--scaling") && ((i + 1) < argc))
+    {
+      const std::string scaling(argv[++i]);
+      std::vector<std::pair<DISPLAY_SCALING, std::string>>::const_iterator d = std::find_if(DISPLAY_SCALINGS.cbegin(), DISPLAY_SCALINGS.cend(), [&scaling](const std::pair<DISPLAY_SCALING, std::string>& d){ return (strcasecmp(d.second.c_str(), scaling.c_str()) == 0); });
+      if (d == DISPLAY_SCALINGS.cend())
+      {
+        std::cout << "Invalid scaling: " << scaling << std::endl;
+        return -1;
+      }
+      display_scaling_index = std::distance(DISPLAY_SCALINGS.cbegin(), d);
+    }
+    else if ((arg == "--memory-limit") && ((i + 1) < argc))
+    {
+      memory_limit = std::strtoull(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--fullscreen")
+    {
+      fullscreen = true;
+    }
+    else if ((arg == "--overlay-refresh") && ((i + 1) < argc))
+    {
+      overlay_refresh = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (arg == "--kiosk")
+    {
+      kiosk = true;
+    }
+    else if (arg == "--record")
+    {
+      record = true;
+    }
+    else if (arg == "--shader-colour")
+    {
+      shader_colour = true;
+    }
+    else if (arg == "--mosaic")
+    {
+      mosaic = true;
+    }
+    else if (arg == "--software")
+    {
+      software = true;
+    }
+    else if (arg == "--export-stand-in")
+    {
+      export_stand_in = true;
+    }
+    else if (mosaic)
+    {
+      // Each tile is a comma separated list of alternative sources for the same camera
+      std::vector<std::string> sources;
+      boost::split(sources, arg, boost::is_any_of(","), boost::token_compress_on);
+      sources.erase(std::remove(sources.begin(), sources.end(), std::string()), sources.end());
+      if (sources.size())
+      {
+        mosaic_tiles.push_back(sources);
+      }
+    }
+    else
+    {
+      path = arg;
+    }
+  }
+  if ((path.empty() && !export_stand_in && mosaic_tiles.empty() && benchmark_manifest.empty()) || (export_stand_in && export_path.empty()))
   {
-    std::cout << "./RockchipPlayer test.mp4" << std::endl;
+    std::cout << "./RockchipPlayer [--export socket] [--scaler none|rga|software] [--shader-colour] [--software] [--record] [--record-format mp4|mkv] [--record-pre-event seconds] [--record-budget MB] [--record-segment seconds] [--kiosk] [--overlay-refresh ms] [--fullscreen] [--scaling letterbox|fill|stretch] [--memory-limit MB] test.mp4" << std::endl;
+    std::cout << "./RockchipPlayer --export socket --export-stand-in" << std::endl;
+    std::cout << "./RockchipPlayer [--kiosk] [--overlay-refresh ms] [--fullscreen] [--memory-limit MB] --mosaic camera1_main.mp4,camera1_sub.mp4 camera2_main.mp4,camera2_sub.mp4 ..." << std::endl;
+    std::cout << "./RockchipPlayer --benchmark manifest.txt [--software] [--benchmark-report report.csv] [--benchmark-baseline baseline.csv] [--benchmark-threshold percent] [--memory-limit MB]" << std::endl;
     return -1;
   }
   // Signals
@@ -346,37 +839,33 @@ int main(int argc, char** argv)
     std::cout << "Failed to register SIGTERM" << std::endl;
     return -3;
   }
-  // Open the file
-  std::cout << "Opening the file: " << argv[1] << std::endl;
-  AVFormatContext* format_context = nullptr;
-  if (avformat_open_input(&format_context, argv[1], nullptr, nullptr) != 0)
-  {
-    std::cout << "Failed to open avformat file: " << argv[1] << std::endl;
-    return -4;
-  }
-  BOOST_SCOPE_EXIT(format_context)
-  {
-    avformat_close_input(&format_context);
-  }
-  BOOST_SCOPE_EXIT_END
-  if (avformat_find_stream_info(format_context, nullptr) < 0)
+  // Memory accounting, shared by every stream
+  MEMORY memory;
+  memory.SetLimit(memory_limit * 1024 * 1024);
+  // Benchmarks run headless, so there is no window or GL
+  if (benchmark_manifest.size())
   {
-    std::cout << "Failed to find stream info: " << argv[1] << std::endl;
-    return -5;
+    return RunBenchmark(running, memory, benchmark_manifest, software, benchmark_report, benchmark_baseline, benchmark_threshold);
   }
-  std::optional<unsigned int> videostream;
-  for (unsigned int i = 0; i < format_context->nb_streams; i++)
+  // Frame export
+  FRAME_EXPORT frame_export;
+  if (export_path.size())
   {
-    if ((format_context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) && (format_context->streams[i]->codecpar->codec_id == AVCodecID::AV_CODEC_ID_H264)) // Currently only support H264
+    std::cout << "Exporting frames on: " << export_path << std::endl;
+    if (frame_export.Init(export_path, 4))
     {
-      videostream = i;
-      break;
+      std::cout << "Failed to initialise frame export" << std::endl;
+      return -36;
     }
   }
-  if (!videostream.has_value())
+  BOOST_SCOPE_EXIT(&frame_export)
   {
-    std::cout << "Failed to find video stream: " << argv[1] << std::endl;
-    return -6;
+    frame_export.Destroy();
+  }
+  BOOST_SCOPE_EXIT_END
+  if (export_stand_in)
+  {
+    return RunExportStandIn(frame_export);
   }
   // Setup window
   std::cout << "Creating window" << std::endl;
@@ -395,8 +884,8 @@ int main(int argc, char** argv)
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
   glfwWindowHint(GLFW_DECORATED, true);
-  glfwWindowHint(GLFW_RESIZABLE, false);
-  GLFWwindow* window = glfwCreateWindow(1024, 768, "Player", nullptr, nullptr);
+  glfwWindowHint(GLFW_RESIZABLE, true);
+  GLFWwindow* window = glfwCreateWindow(DISPLAY_DEFAULT_WIDTH, DISPLAY_DEFAULT_HEIGHT, "Player", nullptr, nullptr);
   if (!window)
   {
     std::cout << "Failed to create window" << std::endl;
@@ -407,7 +896,14 @@ int main(int argc, char** argv)
     glfwDestroyWindow(window);
   }
   BOOST_SCOPE_EXIT_END
-  glfwMakeContextCurrent(window);
+  glfwSetWindowSizeLimits(window, 320, 240, GLFW_DONT_CARE, GLFW_DONT_CARE);
+  DISPLAY_WINDOW windowed;
+  if (SetFullscreen(window, fullscreen, windowed))
+  {
+    std::cout << "Failed to go fullscreen" << std::endl;
+    return -58;
+  }
+  glfwMakeContextCurrent(window);
   BOOST_SCOPE_EXIT(void)
   {
     glfwMakeContextCurrent(nullptr);
@@ -437,6 +933,12 @@ int main(int argc, char** argv)
   }
   BOOST_SCOPE_EXIT_END
   ImGui::GetIO().IniFilename = nullptr; // Don't load or save settings
+  OVERLAY overlay;
+  if (overlay.Init(window, overlay_refresh))
+  {
+    std::cout << "Failed to initialise overlay" << std::endl;
+    return -57;
+  }
   if (ImGui_ImplGlfw_InitForOpenGL(window, true) == false)
   {
     std::cout << "Failed to initialise ImGui" << std::endl;
@@ -468,6 +970,39 @@ int main(int argc, char** argv)
     GL_CHECK(glDeleteProgram(shader_program));
   }
   BOOST_SCOPE_EXIT_END
+  const GLuint nv12_shader_program = GL_CHECK(glCreateProgram());
+  if (nv12_shader_program == 0)
+  {
+    std::cout << "Failed to create NV12 shader" << std::endl;
+    return -39;
+  }
+  BOOST_SCOPE_EXIT(nv12_shader_program)
+  {
+    GL_CHECK(glDeleteProgram(nv12_shader_program));
+  }
+  BOOST_SCOPE_EXIT_END
+  const GLuint yuv420p_shader_program = GL_CHECK(glCreateProgram());
+  if (yuv420p_shader_program == 0)
+  {
+    std::cout << "Failed to create YUV420P shader" << std::endl;
+    return -46;
+  }
+  BOOST_SCOPE_EXIT(yuv420p_shader_program)
+  {
+    GL_CHECK(glDeleteProgram(yuv420p_shader_program));
+  }
+  BOOST_SCOPE_EXIT_END
+  const GLuint display_shader_program = GL_CHECK(glCreateProgram());
+  if (display_shader_program == 0)
+  {
+    std::cout << "Failed to create display shader" << std::endl;
+    return -59;
+  }
+  BOOST_SCOPE_EXIT(display_shader_program)
+  {
+    GL_CHECK(glDeleteProgram(display_shader_program));
+  }
+  BOOST_SCOPE_EXIT_END
   if (CreateShader(oes_shader_program, GL_VERTEX_SHADER, vertex_shader.c_str(), vertex_shader.size()))
   {
     std::cout << "Failed to create OES vertex shader" << std::endl;
@@ -488,6 +1023,36 @@ int main(int argc, char** argv)
     std::cout << "Failed to create pixel shader" << std::endl;
     return -16;
   }
+  if (CreateShader(nv12_shader_program, GL_VERTEX_SHADER, vertex_shader.c_str(), vertex_shader.size()))
+  {
+    std::cout << "Failed to create NV12 vertex shader" << std::endl;
+    return -40;
+  }
+  if (CreateShader(nv12_shader_program, GL_FRAGMENT_SHADER, nv12_fragment_shader.c_str(), nv12_fragment_shader.size()))
+  {
+    std::cout << "Failed to create NV12 pixel shader" << std::endl;
+    return -41;
+  }
+  if (CreateShader(yuv420p_shader_program, GL_VERTEX_SHADER, vertex_shader.c_str(), vertex_shader.size()))
+  {
+    std::cout << "Failed to create YUV420P vertex shader" << std::endl;
+    return -47;
+  }
+  if (CreateShader(yuv420p_shader_program, GL_FRAGMENT_SHADER, yuv420p_fragment_shader.c_str(), yuv420p_fragment_shader.size()))
+  {
+    std::cout << "Failed to create YUV420P pixel shader" << std::endl;
+    return -48;
+  }
+  if (CreateShader(display_shader_program, GL_VERTEX_SHADER, display_vertex_shader.c_str(), display_vertex_shader.size()))
+  {
+    std::cout << "Failed to create display vertex shader" << std::endl;
+    return -60;
+  }
+  if (CreateShader(display_shader_program, GL_FRAGMENT_SHADER, fragment_shader.c_str(), fragment_shader.size()))
+  {
+    std::cout << "Failed to create display pixel shader" << std::endl;
+    return -61;
+  }
   // Bind attributes
   GLuint position_location = 0;
   GLuint texture_coord_location = 1;
@@ -495,6 +1060,12 @@ int main(int argc, char** argv)
   GL_CHECK(glBindAttribLocation(oes_shader_program, texture_coord_location, "texcoord"));
   GL_CHECK(glBindAttribLocation(shader_program, position_location, "position"));
   GL_CHECK(glBindAttribLocation(shader_program, texture_coord_location, "texcoord"));
+  GL_CHECK(glBindAttribLocation(nv12_shader_program, position_location, "position"));
+  GL_CHECK(glBindAttribLocation(nv12_shader_program, texture_coord_location, "texcoord"));
+  GL_CHECK(glBindAttribLocation(yuv420p_shader_program, position_location, "position"));
+  GL_CHECK(glBindAttribLocation(yuv420p_shader_program, texture_coord_location, "texcoord"));
+  GL_CHECK(glBindAttribLocation(display_shader_program, position_location, "position"));
+  GL_CHECK(glBindAttribLocation(display_shader_program, texture_coord_location, "texcoord"));
   // Link
   GL_CHECK(glLinkProgram(oes_shader_program));
   GLint result = GL_FALSE;
@@ -512,6 +1083,30 @@ int main(int argc, char** argv)
     std::cout << "Failed to link shader" << std::endl;
     return -18;
   }
+  GL_CHECK(glLinkProgram(nv12_shader_program));
+  result = GL_FALSE;
+  GL_CHECK(glGetProgramiv(nv12_shader_program, GL_LINK_STATUS, &result));
+  if (result == GL_FALSE)
+  {
+    std::cout << "Failed to link NV12 shader" << std::endl;
+    return -42;
+  }
+  GL_CHECK(glLinkProgram(yuv420p_shader_program));
+  result = GL_FALSE;
+  GL_CHECK(glGetProgramiv(yuv420p_shader_program, GL_LINK_STATUS, &result));
+  if (result == GL_FALSE)
+  {
+    std::cout << "Failed to link YUV420P shader" << std::endl;
+    return -49;
+  }
+  GL_CHECK(glLinkProgram(display_shader_program));
+  result = GL_FALSE;
+  GL_CHECK(glGetProgramiv(display_shader_program, GL_LINK_STATUS, &result));
+  if (result == GL_FALSE)
+  {
+    std::cout << "Failed to link display shader" << std::endl;
+    return -62;
+  }
   // VAO
   GLuint vao = GL_INVALID_VALUE;
   GL_CHECK(glGenVertexArrays(1, &vao));
@@ -577,86 +1172,183 @@ int main(int argc, char** argv)
     std::cout << "Failed to retrieve texture sampler location" << std::endl;
     return -20;
   }
-  // Setup decoder
-  std::cout << "Setting up decoder" << std::endl;
-  MppCtx context;
-  MppApi* api = nullptr;
-  MppPacket packet;
-  MppBufferGroup frame_group;
-  size_t packet_buffer_size = 64;
-  std::unique_ptr<char[]> packet_buffer = std::make_unique<char[]>(packet_buffer_size);
-  int ret = mpp_packet_init(&packet, packet_buffer.get(), packet_buffer_size);
-  if (ret)
-  {
-    std::cout << "Failed to initialise MPP packet" << std::endl;
-    return -21;
+  const GLint nv12_luma_location = GL_CHECK(glGetUniformLocation(nv12_shader_program, "luma"));
+  const GLint nv12_chroma_location = GL_CHECK(glGetUniformLocation(nv12_shader_program, "chroma"));
+  const GLint nv12_matrix_location = GL_CHECK(glGetUniformLocation(nv12_shader_program, "yuv_matrix"));
+  const GLint nv12_offset_location = GL_CHECK(glGetUniformLocation(nv12_shader_program, "yuv_offset"));
+  if ((nv12_luma_location == -1) || (nv12_chroma_location == -1) || (nv12_matrix_location == -1) || (nv12_offset_location == -1))
+  {
+    std::cout << "Failed to retrieve NV12 shader uniform locations" << std::endl;
+    return -43;
+  }
+  const GLint yuv420p_luma_location = GL_CHECK(glGetUniformLocation(yuv420p_shader_program, "luma"));
+  const GLint yuv420p_chroma_u_location = GL_CHECK(glGetUniformLocation(yuv420p_shader_program, "chroma_u"));
+  const GLint yuv420p_chroma_v_location = GL_CHECK(glGetUniformLocation(yuv420p_shader_program, "chroma_v"));
+  const GLint yuv420p_matrix_location = GL_CHECK(glGetUniformLocation(yuv420p_shader_program, "yuv_matrix"));
+  const GLint yuv420p_offset_location = GL_CHECK(glGetUniformLocation(yuv420p_shader_program, "yuv_offset"));
+  if ((yuv420p_luma_location == -1) || (yuv420p_chroma_u_location == -1) || (yuv420p_chroma_v_location == -1) || (yuv420p_matrix_location == -1) || (yuv420p_offset_location == -1))
+  {
+    std::cout << "Failed to retrieve YUV420P shader uniform locations" << std::endl;
+    return -50;
+  }
+  const GLint display_sampler_location = GL_CHECK(glGetUniformLocation(display_shader_program, "tex"));
+  const GLint display_position_location = GL_CHECK(glGetUniformLocation(display_shader_program, "position_transform"));
+  const GLint display_texcoord_location = GL_CHECK(glGetUniformLocation(display_shader_program, "texcoord_transform"));
+  if ((display_sampler_location == -1) || (display_position_location == -1) || (display_texcoord_location == -1))
+  {
+    std::cout << "Failed to retrieve display shader uniform locations" << std::endl;
+    return -63;
+  }
+  // Textures the luma and chroma plane images are bound to
+  GLuint plane_textures[2] = { GL_INVALID_VALUE, GL_INVALID_VALUE };
+  GL_CHECK(glGenTextures(2, plane_textures));
+  BOOST_SCOPE_EXIT(&plane_textures)
+  {
+    GL_CHECK(glDeleteTextures(2, plane_textures));
+  }
+  BOOST_SCOPE_EXIT_END
+  for (const GLuint plane_texture : plane_textures)
+  {
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, plane_texture));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+  }
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+  // Snapshots
+  SNAPSHOT snapshot;
+  if (snapshot.Init(4, 16))
+  {
+    std::cout << "Failed to initialise snapshots" << std::endl;
+    return -35;
+  }
+  BOOST_SCOPE_EXIT(&snapshot)
+  {
+    snapshot.Destroy();
   }
-  ret = mpp_create(&context, &api);
-  if (ret != MPP_OK)
+  BOOST_SCOPE_EXIT_END
+  // Software decoded frames come up through here
+  TEXTURE_UPLOAD texture_upload;
+  if (texture_upload.Init(3))
+  {
+    std::cout << "Failed to initialise texture upload" << std::endl;
+    return -51;
+  }
+  BOOST_SCOPE_EXIT(&texture_upload)
+  {
+    texture_upload.Destroy();
+  }
+  BOOST_SCOPE_EXIT_END
+  // The mosaic has its own sources and decoders
+  if (mosaic_tiles.size())
+  {
+    return RunMosaic(window, windowed, mosaic_tiles, memory, overlay, kiosk, oes_shader_program, oes_texture_sampler_location, shader_program, texture_sampler_location, vao);
+  }
+  // Open the file
+  std::cout << "Opening the file: " << path << std::endl;
+  AVFormatContext* format_context = nullptr;
+  if (avformat_open_input(&format_context, path.c_str(), nullptr, nullptr) != 0)
   {
-    std::cout << "Failed to create MPP context" << std::endl;
-    return -22;
+    std::cout << "Failed to open avformat file: " << path << std::endl;
+    return -4;
+  }
+  BOOST_SCOPE_EXIT(format_context)
+  {
+    avformat_close_input(&format_context);
   }
-  MpiCmd mpi_cmd = MPP_DEC_SET_PARSER_SPLIT_MODE;
-  RK_U32 need_split = 1;
-  MppParam param = &need_split;
-  ret = api->control(context, mpi_cmd, param);
-  if (ret != MPP_OK)
+  BOOST_SCOPE_EXIT_END
+  if (avformat_find_stream_info(format_context, nullptr) < 0)
   {
-    std::cout << "Failed to set MPP split mode" << std::endl;
-    return  -23;
+    std::cout << "Failed to find stream info: " << path << std::endl;
+    return -5;
   }
-  ret = mpp_init(context, MPP_CTX_DEC, MPP_VIDEO_CodingAVC);
-  if (ret != MPP_OK)
+  std::optional<unsigned int> videostream;
+  for (unsigned int i = 0; i < format_context->nb_streams; i++)
   {
-    std::cout << "Failed to set MPP H264" << std::endl;
-    return -24;
+    if ((format_context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) && (format_context->streams[i]->codecpar->codec_id == AVCodecID::AV_CODEC_ID_H264)) // Currently only support H264
+    {
+      videostream = i;
+      break;
+    }
   }
-  // Find SPS/PPS if available and pass it to the decoder
-  std::vector<uint8_t> spspps;
-  if (format_context->streams[*videostream]->codecpar->extradata && format_context->streams[*videostream]->codecpar->extradata_size)
+  if (!videostream.has_value())
   {
-    const std::vector<uint8_t> extradata(format_context->streams[*videostream]->codecpar->extradata, format_context->streams[*videostream]->codecpar->extradata + format_context->streams[*videostream]->codecpar->extradata_size);
-    if (extradata.size())
+    // Anything the VPU path does not handle goes to the software decoder
+    for (unsigned int i = 0; i < format_context->nb_streams; i++)
     {
-      if (extradata[0] >= 1) // SPS+PPS count, but we only care about the first one
+      if (format_context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
       {
-        const int spscount = extradata[5] & 0x1f;
-        const int spsnalsize = (extradata[6] << 8) | extradata[7];
-        if ((spsnalsize + 8) <= extradata.size())
-        {
-          std::cout << "Gathering SPS: " << spsnalsize << std::endl;
-          spspps.insert(spspps.end(), extradata.data() + 8, extradata.data() + 8 + spsnalsize);
-          if ((spsnalsize + 8 + 1) <= extradata.size())
-          {
-            const int ppscount = extradata[8 + spsnalsize] & 0x1f;
-            if (ppscount >= 1)
-            {
-              if ((spsnalsize + 8 + 1 + 2) < extradata.size())
-              {
-                const int ppsnalsize = (extradata[8 + spsnalsize + 1] << 8) | extradata[8 + spsnalsize + 2];
-                if ((spsnalsize + 8 + 1 + 2 + ppsnalsize) <= extradata.size())
-                {
-                  std::cout << "Gathering PPS: " << ppsnalsize << std::endl;
-                  spspps.insert(spspps.end(), H264_START_SEQUENCE, H264_START_SEQUENCE + sizeof(H264_START_SEQUENCE));
-                  spspps.insert(spspps.end(), extradata.data() + 8 + spsnalsize + 3, extradata.data() + 8 + spsnalsize + 3 + ppsnalsize);
-                }
-              }
-            }
-          }
-        }
+        videostream = i;
+        software = true;
+        break;
       }
     }
   }
-  if (spspps.size())
+  if (!videostream.has_value())
+  {
+    std::cout << "Failed to find video stream: " << path << std::endl;
+    return -6;
+  }
+  // Account for the stream before the decoder allocates anything, the software decoder's frames are ordinary heap memory
+  const AVCodecParameters* codecpar = format_context->streams[*videostream]->codecpar;
+  const int memory_stream = memory.Open(path, software ? 0 : EstimateStreamMemory(codecpar->width, codecpar->height));
+  if (memory_stream < 0)
   {
-    std::cout << "Sending SPS and PPS" << std::endl;
-    if (SendFrame(api, context, spspps.data(), spspps.size(), packet, packet_buffer, packet_buffer_size))
+    std::cout << "Not enough memory to open stream: " << path << std::endl;
+    return -64;
+  }
+  BOOST_SCOPE_EXIT(&memory, memory_stream)
+  {
+    memory.Close(memory_stream);
+  }
+  BOOST_SCOPE_EXIT_END
+  // Setup decoder
+  std::cout << "Setting up decoder" << std::endl;
+  MPP_DECODER mpp_decoder;
+  SOFTWARE_DECODER software_decoder;
+  if (software)
+  {
+    std::cout << "Using software decoder" << std::endl;
+    if (software_decoder.Init(format_context->streams[*videostream]->codecpar))
     {
-      std::cout << "Failed to send SPS+PPS frame" << std::endl;
-      return -25;
+      std::cout << "Failed to initialise software decoder" << std::endl;
+      return -52;
     }
   }
+  else if (mpp_decoder.Init(format_context->streams[*videostream]->codecpar))
+  {
+    std::cout << "Failed to initialise MPP decoder" << std::endl;
+    return -21;
+  }
+  // Corrupt packets and decode errors drop back to the next IDR rather than stopping playback
+  RECOVERY recovery;
+  // Scaler output buffers are dma-bufs so they can be imported just like decoded frames
+  MPP_SCALER_ALLOCATOR scaler_allocator;
+  if (!software && scaler_allocator.Init())
+  {
+    std::cout << "Failed to initialise scaler allocator" << std::endl;
+    return -38;
+  }
+  // Pass-through recording of the packets we are already reading
+  RECORDER recorder;
+  if (recorder.Init(format_context->streams[*videostream], RECORDER_FORMATS[recorder_format_index].first, record_pre_event, record_budget * 1024 * 1024, record_segment))
+  {
+    std::cout << "Failed to initialise recorder" << std::endl;
+    return -56;
+  }
+  BOOST_SCOPE_EXIT(&recorder)
+  {
+    recorder.Destroy();
+  }
+  BOOST_SCOPE_EXIT_END
+  if (record)
+  {
+    recorder.Start();
+  }
+  std::unique_ptr<SCALER> scaler = CreateScaler(SCALER_TYPES[scaler_index].first);
+  int scaler_format_index = 0;
+  double scaler_time = 0.0;
   // Start main loop
   std::cout << "Starting main loop" << std::endl;
   MppFrame source_frame = nullptr;
@@ -673,14 +1365,22 @@ int main(int argc, char** argv)
   }
   BOOST_SCOPE_EXIT_END
   std::unique_ptr<FRAME_BUFFER> frame_buffer;
-  bool show_window = true;
+  bool show_window = !kiosk;
+  bool fullscreen_key = false;
+  DISPLAY_ROI roi;
+  double frame_time = 0.0;
   boost::optional<MppFrameColorSpace> mpp_colour_space;
   boost::optional<MppFrameColorRange> mpp_colour_range;
   boost::optional<MppFrameColorPrimaries> mpp_colour_primaries;
   int egl_colour_space_override_index = 1;
   int egl_colour_range_override_index = 1;
+  int colour_conversion_index = shader_colour ? 1 : 0;
+  boost::optional<int> shader_verify_error;
+  bool snapshot_burst = false;
+  int snapshot_format_index = 0;
   while (!glfwWindowShouldClose(window) && running)
   {
+    const std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
     // Calculate time of frame
     if (av_packet)
     {
@@ -695,7 +1395,7 @@ int main(int argc, char** argv)
     if (av_packet == nullptr)
     {
       av_packet = av_packet_alloc();
-      ret = av_read_frame(format_context, av_packet);
+      int ret = av_read_frame(format_context, av_packet);
       if (ret == AVERROR_EOF)
       {
         ret = av_seek_frame(format_context, *videostream, 0, AVSEEK_FLAG_ANY);
@@ -704,48 +1404,172 @@ int main(int argc, char** argv)
           std::cout << "Failed to seek frame" << std::endl;
           return -26;
         }
+        software_decoder.Flush();
         start = std::chrono::steady_clock::now();
+        // Nothing was read, so go round again for the first packet
+        av_packet_free(&av_packet);
+        continue;
       }
       else if (ret)
       {
-        std::cout << "Failed to seek frame" << std::endl;
-        return -27;
+        // Carry on from whatever can be read next, the packet time is lost so it is not waited for
+        std::cout << "Failed to read frame: " << ret << std::endl;
+        recovery.Error(false);
+        av_packet_free(&av_packet);
       }
       // Video
-      if (av_packet->stream_index != *videostream)
+      else if (av_packet->stream_index != *videostream)
       {
         av_packet_free(&av_packet);
         continue;
       }
-      // Send
-      const uint8_t* ptr = av_packet->data;
-      size_t size = av_packet->size;
-      while (size > 5)
+      else
       {
-        const uint32_t nal_size = htonl(*reinterpret_cast<const uint32_t*>(ptr));
-        ptr += 4;
-        size -= 4;
-        if (nal_size > size)
+        // Send, unless we are waiting for an IDR to resync on
+        if (recovery.Accept(av_packet))
         {
-          std::cout << "Illegal NAL size " << nal_size << std::endl;
-          break;
+          if (software)
+          {
+            // avcodec picks itself up at the next keyframe, so it does not need flushing
+            if (software_decoder.SendPacket(av_packet))
+            {
+              std::cout << "Failed to send frame: " << av_packet->size << std::endl;
+              recovery.Error(false);
+            }
+          }
+          else
+          {
+            ret = mpp_decoder.SendPacket(av_packet);
+            if (ret < 0)
+            {
+              std::cout << "Failed to send frame: " << av_packet->size << std::endl;
+              if (mpp_decoder.Reset())
+              {
+                std::cout << "Failed to reset MPP decoder" << std::endl;
+                return -28;
+              }
+              recovery.Error(true);
+            }
+            else if (ret == 1)
+            {
+              recovery.Error(false);
+            }
+          }
         }
-        // Build mpp frame
-        if (SendFrame(api, context, ptr, nal_size, packet, packet_buffer, packet_buffer_size))
+        // The decoder has it, so the recorder only takes a reference afterwards
+        recorder.Push(av_packet);
+      }
+    }
+    // Collect any output frames
+    const AVFrame* software_frame = nullptr;
+    if (software)
+    {
+      const int ret = software_decoder.GetFrame(software_frame);
+      if (ret < 0)
+      {
+        std::cout << "Failed to get software frame" << std::endl;
+        software_decoder.Flush();
+        recovery.Error(true);
+      }
+      else if (ret == 2)
+      {
+        recovery.Error(false);
+      }
+      else if (software_frame && (software_frame->format != AV_PIX_FMT_NV12) && (software_frame->format != AV_PIX_FMT_YUV420P) && (software_frame->format != AV_PIX_FMT_YUVJ420P))
+      {
+        std::cout << "Invalid software frame format: " << software_frame->format << std::endl;
+        software_frame = nullptr;
+        recovery.Error(false);
+      }
+    }
+    else
+    {
+      const int ret = mpp_decoder.GetFrame(source_frame);
+      if (ret < 0)
+      {
+        std::cout << "Failed to get MPP frame" << std::endl;
+        if (mpp_decoder.Reset())
         {
-          std::cout << "Failed to send frame: " << nal_size << std::endl;
-          return -28;
+          std::cout << "Failed to reset MPP decoder" << std::endl;
+          return -29;
         }
-        ptr += nal_size;
-        size -= nal_size;
+        recovery.Error(true);
+      }
+      else if ((ret == 2) && scaler)
+      {
+        scaler->Reset();
+      }
+      else if (ret == 3)
+      {
+        recovery.Error(false);
+      }
+      else if (source_frame && ((mpp_frame_get_buffer(source_frame) == nullptr) || (mpp_frame_get_fmt(source_frame) != MPP_FMT_YUV420SP)))
+      {
+        std::cout << "Invalid frame format" << std::endl;
+        mpp_frame_deinit(&source_frame);
+        source_frame = nullptr;
+        recovery.Error(false);
       }
     }
-    // Collect any output frames
-    ret = api->decode_get_frame(context, &source_frame);
-    if (ret != MPP_OK)
+    if (software_frame || source_frame)
     {
-      std::cout << "Failed to get frame: " << ret << std::endl;
-      return -29;
+      recovery.Frame();
+    }
+    if (software_frame)
+    {
+      // Upload the planes as they are and leave the conversion to the shader
+      const TEXTURE_UPLOAD_FORMAT upload_format = (software_frame->format == AV_PIX_FMT_NV12) ? TEXTURE_UPLOAD_FORMAT::NV12 : TEXTURE_UPLOAD_FORMAT::YUV420P;
+      if (texture_upload.Upload(upload_format, software_frame->width, software_frame->height, software_frame->data, software_frame->linesize) == 0)
+      {
+        if (BindFrameBuffer(frame_buffer, software_frame->width, software_frame->height))
+        {
+          return -34;
+        }
+        GL_CHECK(glViewport(0, 0, frame_buffer->width_, frame_buffer->height_));
+        const YUV_MATRIX yuv_matrix = GetYUVMatrix(GetYUVColourSpace(EGL_COLOUR_SPACES[egl_colour_space_override_index].first), EGL_COLOUR_RANGES[egl_colour_range_override_index].first == EGL_YUV_FULL_RANGE_EXT);
+        if (upload_format == TEXTURE_UPLOAD_FORMAT::NV12)
+        {
+          GL_CHECK(glUseProgram(nv12_shader_program));
+          GL_CHECK(glUniform1i(nv12_luma_location, 0));
+          GL_CHECK(glUniform1i(nv12_chroma_location, 1));
+          GL_CHECK(glUniformMatrix3fv(nv12_matrix_location, 1, GL_FALSE, yuv_matrix.matrix_));
+          GL_CHECK(glUniform3fv(nv12_offset_location, 1, yuv_matrix.offset_));
+        }
+        else
+        {
+          GL_CHECK(glUseProgram(yuv420p_shader_program));
+          GL_CHECK(glUniform1i(yuv420p_luma_location, 0));
+          GL_CHECK(glUniform1i(yuv420p_chroma_u_location, 1));
+          GL_CHECK(glUniform1i(yuv420p_chroma_v_location, 2));
+          GL_CHECK(glUniformMatrix3fv(yuv420p_matrix_location, 1, GL_FALSE, yuv_matrix.matrix_));
+          GL_CHECK(glUniform3fv(yuv420p_offset_location, 1, yuv_matrix.offset_));
+          GL_CHECK(glActiveTexture(GL_TEXTURE2));
+          GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture_upload.GetTexture(2)));
+        }
+        GL_CHECK(glActiveTexture(GL_TEXTURE1));
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture_upload.GetTexture(1)));
+        GL_CHECK(glActiveTexture(GL_TEXTURE0));
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture_upload.GetTexture(0)));
+        // Draw elements
+        GL_CHECK(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+        GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
+        GL_CHECK(glBindVertexArray(vao));
+        GL_CHECK(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
+        // Cleanup
+        GL_CHECK(glBindVertexArray(0));
+        GL_CHECK(glActiveTexture(GL_TEXTURE2));
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+        GL_CHECK(glActiveTexture(GL_TEXTURE1));
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+        GL_CHECK(glActiveTexture(GL_TEXTURE0));
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+        GL_CHECK(glUseProgram(0));
+        GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+        if (snapshot_burst)
+        {
+          snapshot.Capture(frame_buffer->frame_, frame_buffer->width_, frame_buffer->height_, SNAPSHOT_FORMATS[snapshot_format_index].first);
+        }
+      }
     }
     if (source_frame)
     {
@@ -754,202 +1578,463 @@ int main(int argc, char** argv)
         mpp_frame_deinit(&source_frame);
       }
       BOOST_SCOPE_EXIT_END
-      if (mpp_frame_get_info_change(source_frame))
+      MppBuffer mpp_buffer = mpp_frame_get_buffer(source_frame);
+      // The overlay shows the colour metadata, so it only needs redrawing when that changes
+      if ((mpp_colour_space != mpp_frame_get_colorspace(source_frame)) || (mpp_colour_range != mpp_frame_get_color_range(source_frame)) || (mpp_colour_primaries != mpp_frame_get_color_primaries(source_frame)))
+      {
+        overlay.Invalidate();
+      }
+      mpp_colour_space = mpp_frame_get_colorspace(source_frame);
+      mpp_colour_range = mpp_frame_get_color_range(source_frame);
+      mpp_colour_primaries = mpp_frame_get_color_primaries(source_frame);
+      const RK_U32 width = mpp_frame_get_width(source_frame);
+      const RK_U32 height = mpp_frame_get_height(source_frame);
+      const RK_U32 offset_x = mpp_frame_get_offset_x(source_frame);
+      const RK_U32 offset_y = mpp_frame_get_offset_y(source_frame);
+      const RK_U32 hor_stride = mpp_frame_get_hor_stride(source_frame);
+      const RK_U32 ver_stride = mpp_frame_get_ver_stride(source_frame);
+      // Export the buffer to any subscribers, it goes back to the decoder once they have all released it
+      if (frame_export.HasSubscribers())
       {
-        std::cout << "Frame dimensions and format changed" << std::endl;
-        ret = mpp_buffer_group_get_internal(&frame_group, MPP_BUFFER_TYPE_DRM);
-        if (ret)
+        FRAME_EXPORT_FRAME header;
+        std::memset(&header, 0, sizeof(header));
+        header.pts_ = mpp_frame_get_pts(source_frame);
+        header.time_base_num_ = format_context->streams[*videostream]->time_base.num;
+        header.time_base_den_ = format_context->streams[*videostream]->time_base.den;
+        header.width_ = width;
+        header.height_ = height;
+        header.crop_x_ = offset_x;
+        header.crop_y_ = offset_y;
+        header.drm_format_ = DRM_FORMAT_NV12;
+        header.plane_count_ = 2;
+        header.planes_[0].offset_ = 0;
+        header.planes_[0].pitch_ = hor_stride;
+        header.planes_[1].offset_ = hor_stride * ver_stride;
+        header.planes_[1].pitch_ = hor_stride;
+        header.size_ = mpp_buffer_get_size(mpp_buffer);
+        header.colour_space_ = *mpp_colour_space;
+        header.colour_range_ = *mpp_colour_range;
+        header.colour_primaries_ = *mpp_colour_primaries;
+        if (mpp_buffer_inc_ref(mpp_buffer) == MPP_OK)
         {
-          std::cout << "Failed to set buffer group" << std::endl;
-          return -30;
+          frame_export.Publish(header, mpp_buffer_get_fd(mpp_buffer), [mpp_buffer](){ mpp_buffer_put(mpp_buffer); });
         }
-        api->control(context, MPP_DEC_SET_EXT_BUF_GROUP, frame_group);
-        api->control(context, MPP_DEC_SET_INFO_CHANGE_READY, nullptr);
       }
-      else if (source_frame)
+      // Optionally scale and convert the frame before the GPU sees it
+      SCALER_BUFFER* scaled_buffer = nullptr;
+      BOOST_SCOPE_EXIT(&scaler, &scaled_buffer)
       {
-        MppBuffer mpp_buffer = mpp_frame_get_buffer(source_frame);
-        if (mpp_buffer == nullptr)
+        if (scaled_buffer)
         {
-          std::cout << "Failed to retrieve buffer from frame" << std::endl;
-          return -31;
+          scaler->Release(scaled_buffer);
         }
-        const MppFrameFormat format = mpp_frame_get_fmt(source_frame);
-        if (format != MPP_FMT_YUV420SP)
+      }
+      BOOST_SCOPE_EXIT_END
+      if (scaler)
+      {
+        int window_width = 0;
+        int window_height = 0;
+        glfwGetFramebufferSize(window, &window_width, &window_height);
+        // Fit inside the window keeping the picture's aspect, and never scale up, the GPU does that for free while sampling
+        const double scale = std::min({ 1.0, static_cast<double>(window_width) / width, static_cast<double>(window_height) / height });
+        const uint32_t scaled_width = std::max(static_cast<uint32_t>(width * scale), 2u) & ~1;
+        const uint32_t scaled_height = std::max(static_cast<uint32_t>(height * scale), 2u) & ~1;
+        const SCALER_FORMAT scaler_format = SCALER_FORMATS[scaler_format_index].first;
+        if ((scaler->GetWidth() != scaled_width) || (scaler->GetHeight() != scaled_height) || (scaler->GetFormat() != scaler_format))
+        {
+          DestroyEGLFrames(egl_destroy_image_khr, egl_images); // Some of these refer to the old pool
+          if (scaler->Init(scaled_width, scaled_height, scaler_format, 3, &scaler_allocator))
+          {
+            std::cout << "Failed to initialise scaler" << std::endl;
+            return -37;
+          }
+        }
+        SCALER_FRAME scaler_frame;
+        scaler_frame.fd_ = mpp_buffer_get_fd(mpp_buffer);
+        scaler_frame.ptr_ = (SCALER_TYPES[scaler_index].first == SCALER_TYPE::SOFTWARE) ? reinterpret_cast<uint8_t*>(mpp_buffer_get_ptr(mpp_buffer)) : nullptr;
+        scaler_frame.size_ = mpp_buffer_get_size(mpp_buffer);
+        scaler_frame.width_ = width;
+        scaler_frame.height_ = height;
+        scaler_frame.hor_stride_ = hor_stride;
+        scaler_frame.ver_stride_ = ver_stride;
+        scaler_frame.crop_x_ = offset_x;
+        scaler_frame.crop_y_ = offset_y;
+        scaler_frame.colour_space_ = GetMPPYUVColourSpace(*mpp_colour_space);
+        scaler_frame.full_range_ = (*mpp_colour_range == MPP_FRAME_RANGE_JPEG);
+        const std::chrono::steady_clock::time_point scale_start = std::chrono::steady_clock::now();
+        if (scaler->Scale(scaler_frame, scaled_buffer) == 0) // On failure we just carry on with the unscaled frame
+        {
+          scaler_time = (scaler_time * 0.9) + (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scale_start).count() * 0.1);
+        }
+      }
+      // The buffer the GPU will actually sample
+      const MppBuffer image_buffer = scaled_buffer ? static_cast<MppBuffer>(scaled_buffer->handle_) : mpp_buffer;
+      const RK_U32 image_width = scaled_buffer ? scaler->GetWidth() : width;
+      const RK_U32 image_height = scaled_buffer ? scaler->GetHeight() : height;
+      const bool image_rgba = scaled_buffer && (scaler->GetFormat() == SCALER_FORMAT::RGBA);
+      const RK_U32 image_pitch = scaled_buffer ? (scaled_buffer->hor_stride_ * (image_rgba ? 4 : 1)) : hor_stride;
+      // The driver can't be told the crop, so the planes start at the first visible pixel and the image is the visible size
+      const RK_U32 image_offset = scaled_buffer ? 0 : ((offset_y * hor_stride) + offset_x);
+      const RK_U32 image_chroma_offset = scaled_buffer ? (scaled_buffer->hor_stride_ * scaled_buffer->ver_stride_) : ((hor_stride * ver_stride) + ((offset_y / 2) * hor_stride) + (offset_x & ~1));
+      std::map<MppBuffer, EGL_FRAME>::iterator e = egl_images.find(image_buffer);
+      if (e != egl_images.end())
+      {
+        // Colour only matters when EGL is doing the conversion
+        if ((((e->second.image_ != EGL_NO_IMAGE_KHR) && !image_rgba) && ((e->second.colour_space_ != *mpp_colour_space) || (e->second.colour_range_ != *mpp_colour_range))) || (e->second.width_ != image_width) || (e->second.height_ != image_height))
         {
-          std::cout << "Invalid frame format" << std::endl;
-          return -32;
+          std::cout << "MPP buffer format changed, resetting EGL images" << std::endl;
+          DestroyEGLFrames(egl_destroy_image_khr, egl_images);
+          e = egl_images.end();
         }
-        mpp_colour_space = mpp_frame_get_colorspace(source_frame);
-        mpp_colour_range = mpp_frame_get_color_range(source_frame);
-        mpp_colour_primaries = mpp_frame_get_color_primaries(source_frame);
-        const RK_U32 width = mpp_frame_get_width(source_frame);
-        const RK_U32 height = mpp_frame_get_height(source_frame);
-        const RK_U32 offset_x = mpp_frame_get_offset_x(source_frame);
-        const RK_U32 offset_y = mpp_frame_get_offset_y(source_frame);
-        const RK_U32 hor_stride = mpp_frame_get_hor_stride(source_frame);
-        const RK_U32 ver_stride = mpp_frame_get_ver_stride(source_frame);
-        std::map<MppBuffer, EGL_FRAME>::iterator e = egl_images.find(mpp_buffer);
-        if (e != egl_images.end())
+      }
+      if (e == egl_images.end())
+      {
+        const int egl_colour_space = EGL_COLOUR_SPACES[egl_colour_space_override_index].first;
+        const int egl_colour_range = EGL_COLOUR_RANGES[egl_colour_range_override_index].first;
+        const int fd = mpp_buffer_get_fd(image_buffer);
+        if (shader_colour && !image_rgba)
         {
-          if ((e->second.colour_space_ != *mpp_colour_space) || (e->second.colour_range_ != *mpp_colour_range) || (e->second.width_ != width) || (e->second.height_ != height))
+          // Import the planes on their own so the shader can do the conversion
+          const EGL_IMAGE_PLANE luma_plane = { image_offset, image_pitch };
+          const EGL_IMAGE_PLANE chroma_plane = { image_chroma_offset, image_pitch };
+          EGLint luma_atts[EGL_IMAGE_MAX_ATTRIBUTES];
+          EGLint chroma_atts[EGL_IMAGE_MAX_ATTRIBUTES];
+          GetEGLImageAttributes(luma_atts, fd, image_width, image_height, DRM_FORMAT_R8, &luma_plane, 1, 0, 0);
+          GetEGLImageAttributes(chroma_atts, fd, image_width / 2, image_height / 2, DRM_FORMAT_GR88, &chroma_plane, 1, 0, 0);
+          const EGLImageKHR luma_image = egl_create_image_khr(glfwGetEGLDisplay(), EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, luma_atts);
+          if (luma_image == EGL_NO_IMAGE_KHR)
+          {
+            std::cout << "Failed to create luma EGL image" << std::endl;
+            return -44;
+          }
+          const EGLImageKHR chroma_image = egl_create_image_khr(glfwGetEGLDisplay(), EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, chroma_atts);
+          if (chroma_image == EGL_NO_IMAGE_KHR)
           {
-            std::cout << "MPP buffer format changed, resetting EGL images" << std::endl;
-            DestroyEGLFrames(egl_destroy_image_khr, egl_images);
-            e = egl_images.end();
+            std::cout << "Failed to create chroma EGL image" << std::endl;
+            egl_destroy_image_khr(glfwGetEGLDisplay(), luma_image);
+            return -45;
           }
+          e = egl_images.insert(std::make_pair(image_buffer, EGL_FRAME(EGL_NO_IMAGE_KHR, luma_image, chroma_image, *mpp_colour_space, *mpp_colour_range, image_width, image_height, mpp_buffer_get_size(image_buffer)))).first;
         }
-        if (e == egl_images.end())
+        else
         {
-          const int egl_colour_space = EGL_COLOUR_SPACES[egl_colour_space_override_index].first;
-          const int egl_colour_range = EGL_COLOUR_RANGES[egl_colour_range_override_index].first;
           // Create EGL image
-          const int fd = mpp_buffer_get_fd(mpp_buffer);
-          EGLint atts[] = {
-                            EGL_WIDTH, static_cast<EGLint>(width),
-                            EGL_HEIGHT, static_cast<EGLint>(height),
-                            EGL_LINUX_DRM_FOURCC_EXT, DRM_FORMAT_NV12,
-                            EGL_DMA_BUF_PLANE0_FD_EXT, fd,
-                            EGL_DMA_BUF_PLANE0_OFFSET_EXT, static_cast<EGLint>(offset_x),
-                            EGL_DMA_BUF_PLANE0_PITCH_EXT, static_cast<EGLint>(hor_stride),
-                            EGL_DMA_BUF_PLANE1_FD_EXT, fd,
-                            EGL_DMA_BUF_PLANE1_OFFSET_EXT, static_cast<EGLint>(offset_x + (hor_stride * ver_stride)),
-                            EGL_DMA_BUF_PLANE1_PITCH_EXT, static_cast<EGLint>(hor_stride),
-                            EGL_YUV_COLOR_SPACE_HINT_EXT, egl_colour_space,
-                            EGL_SAMPLE_RANGE_HINT_EXT, egl_colour_range,
-                            EGL_NONE
-                          };
+          const EGL_IMAGE_PLANE planes[] = { { image_offset, image_pitch }, { image_chroma_offset, image_pitch } };
+          EGLint atts[EGL_IMAGE_MAX_ATTRIBUTES];
+          if (image_rgba)
+          {
+            GetEGLImageAttributes(atts, fd, image_width, image_height, DRM_FORMAT_ABGR8888, planes, 1, 0, 0);
+          }
+          else
+          {
+            GetEGLImageAttributes(atts, fd, image_width, image_height, DRM_FORMAT_NV12, planes, 2, egl_colour_space, egl_colour_range);
+          }
           const EGLImageKHR egl_image = egl_create_image_khr(glfwGetEGLDisplay(), EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, atts);
           if (egl_image == EGL_NO_IMAGE_KHR)
           {
             std::cout << "Failed to create EGL image" << std::endl;
             return -33;
           }
-          e = egl_images.insert(std::make_pair(mpp_buffer, EGL_FRAME(egl_image, *mpp_colour_space, *mpp_colour_range, width, height))).first;
-        }
-        // Create and/or frame buffer
-        if (frame_buffer == nullptr)
-        {
-          GLuint frame = GL_INVALID_VALUE;
-          GL_CHECK(glGenFramebuffers(1, &frame));
-          GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, frame));
-          GLuint frame_buffer_texture = GL_INVALID_VALUE;
-          GL_CHECK(glGenTextures(1, &frame_buffer_texture));
-          GL_CHECK(glBindTexture(GL_TEXTURE_2D, frame_buffer_texture));
-          GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
-          GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-          GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-          GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame_buffer_texture, 0));
-          if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-          {
-            std::cout << "Failed to create frame buffer" << std::endl;
-            return -34;
-          }
-          frame_buffer = std::make_unique<FRAME_BUFFER>(frame, frame_buffer_texture, width, height);
-        }
-        else
-        {
-          GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer->frame_));
+          e = egl_images.insert(std::make_pair(image_buffer, EGL_FRAME(egl_image, EGL_NO_IMAGE_KHR, EGL_NO_IMAGE_KHR, *mpp_colour_space, *mpp_colour_range, image_width, image_height, mpp_buffer_get_size(image_buffer)))).first;
         }
+      }
+      // Create and/or frame buffer
+      if (BindFrameBuffer(frame_buffer, image_width, image_height))
+      {
+        return -34;
+      }
+      GL_CHECK(glViewport(0, 0, frame_buffer->width_, frame_buffer->height_));
+      if (e->second.image_ == EGL_NO_IMAGE_KHR)
+      {
+        // Draw the planes with the colour conversion in the shader
+        const YUV_MATRIX yuv_matrix = GetYUVMatrix(GetYUVColourSpace(EGL_COLOUR_SPACES[egl_colour_space_override_index].first), EGL_COLOUR_RANGES[egl_colour_range_override_index].first == EGL_YUV_FULL_RANGE_EXT);
+        GL_CHECK(glUseProgram(nv12_shader_program));
+        GL_CHECK(glActiveTexture(GL_TEXTURE1));
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, plane_textures[1]));
+        GL_CHECK(gl_egl_image_target_texture_2_does(GL_TEXTURE_2D, e->second.chroma_image_));
+        GL_CHECK(glUniform1i(nv12_chroma_location, 1));
+        GL_CHECK(glActiveTexture(GL_TEXTURE0));
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, plane_textures[0]));
+        GL_CHECK(gl_egl_image_target_texture_2_does(GL_TEXTURE_2D, e->second.luma_image_));
+        GL_CHECK(glUniform1i(nv12_luma_location, 0));
+        GL_CHECK(glUniformMatrix3fv(nv12_matrix_location, 1, GL_FALSE, yuv_matrix.matrix_));
+        GL_CHECK(glUniform3fv(nv12_offset_location, 1, yuv_matrix.offset_));
+      }
+      else
+      {
         // Draw the EGL buffer
         GL_CHECK(glUseProgram(oes_shader_program));
         // Textures
         GL_CHECK(glActiveTexture(GL_TEXTURE0));
         GL_CHECK(glUniform1i(oes_texture_sampler_location, 0));
         GL_CHECK(gl_egl_image_target_texture_2_does(GL_TEXTURE_EXTERNAL_OES, e->second.image_));
-        // Draw elements
-        GL_CHECK(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
-        GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
-        GL_CHECK(glBindVertexArray(vao));
-        GL_CHECK(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
-        // Cleanup
-        GL_CHECK(glBindVertexArray(0));
-        GL_CHECK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0));
-        GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
-        GL_CHECK(glUseProgram(0));
-        GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-        // Sync
-        const EGLSyncKHR egl_sync = egl_create_sync_khr(glfwGetEGLDisplay(), EGL_SYNC_FENCE_KHR, nullptr);
-        if (egl_sync == EGL_NO_SYNC_KHR)
-        {
-          std::cout << "Failed to create EGL sync object" << std::endl;
-        }
-        else
-        {
-          if (egl_client_wait_sync_khr(glfwGetEGLDisplay(), egl_sync, EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, EGL_FOREVER_KHR) != EGL_CONDITION_SATISFIED_KHR)
-          {
-            std::cout << "Failed to sync EGL buffers" << std::endl;
-          }
-          if (egl_destroy_sync_khr(glfwGetEGLDisplay(), egl_sync) == EGL_FALSE)
-          {
-            std::cout << "Failed to destroy EGL sync object" << std::endl;
-          }
-        }
       }
-    }
-    // Poll events
-    glfwPollEvents();
-    // Clear
-    GL_CHECK(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
-    GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
-    // Draw video
-    if (frame_buffer)
-    {
-      // Draw the EGL buffer
-      GL_CHECK(glUseProgram(oes_shader_program));
-      // Textures
-      GL_CHECK(glActiveTexture(GL_TEXTURE0));
-      GL_CHECK(glUniform1i(texture_sampler_location, 0));
-      GL_CHECK(glBindTexture(GL_TEXTURE_2D, frame_buffer->texture_));
       // Draw elements
+      GL_CHECK(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+      GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
       GL_CHECK(glBindVertexArray(vao));
       GL_CHECK(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
       // Cleanup
       GL_CHECK(glBindVertexArray(0));
+      GL_CHECK(glActiveTexture(GL_TEXTURE1));
+      GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+      GL_CHECK(glActiveTexture(GL_TEXTURE0));
       GL_CHECK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0));
       GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
       GL_CHECK(glUseProgram(0));
       GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+      // Sync
+      const EGLSyncKHR egl_sync = egl_create_sync_khr(glfwGetEGLDisplay(), EGL_SYNC_FENCE_KHR, nullptr);
+      if (egl_sync == EGL_NO_SYNC_KHR)
+      {
+        std::cout << "Failed to create EGL sync object" << std::endl;
+      }
+      else
+      {
+        if (egl_client_wait_sync_khr(glfwGetEGLDisplay(), egl_sync, EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, EGL_FOREVER_KHR) != EGL_CONDITION_SATISFIED_KHR)
+        {
+          std::cout << "Failed to sync EGL buffers" << std::endl;
+        }
+        if (egl_destroy_sync_khr(glfwGetEGLDisplay(), egl_sync) == EGL_FALSE)
+        {
+          std::cout << "Failed to destroy EGL sync object" << std::endl;
+        }
+      }
+      // Burst snapshots take every decoded frame, after the sync so the readback is not waited on
+      if (snapshot_burst)
+      {
+        snapshot.Capture(frame_buffer->frame_, frame_buffer->width_, frame_buffer->height_, SNAPSHOT_FORMATS[snapshot_format_index].first);
+      }
     }
-    // ImGui window
-    if (show_window)
+    // Memory accounting
+    size_t egl_image_bytes = 0;
+    for (const std::pair<const MppBuffer, EGL_FRAME>& egl_image : egl_images)
+    {
+      egl_image_bytes += egl_image.second.size_;
+    }
+    memory.Set(memory_stream, MEMORY_CATEGORY::MPP_BUFFERS, mpp_decoder.GetBufferBytes() + scaler_allocator.GetBytes(), mpp_decoder.GetBufferCount() + scaler_allocator.GetCount());
+    memory.Set(memory_stream, MEMORY_CATEGORY::EGL_IMAGES, egl_image_bytes, egl_images.size());
+    memory.Set(memory_stream, MEMORY_CATEGORY::FRAME_BUFFERS, (frame_buffer ? frame_buffer->GetBytes() : 0) + overlay.GetBytes(), (frame_buffer ? 1 : 0) + (overlay.GetBytes() ? 1 : 0));
+    memory.Set(memory_stream, MEMORY_CATEGORY::PACKETS, recorder.GetPreEventBytes() + recorder.GetQueuedBytes() + mpp_decoder.GetPacketBytes() + (av_packet ? av_packet->size : 0), recorder.GetPreEventPackets() + recorder.GetQueuedPackets() + (av_packet ? 1 : 0));
+    // Poll events
+    glfwPollEvents();
+    // F11 toggles fullscreen, which works in kiosk mode too
+    const bool fullscreen_key_down = (glfwGetKey(window, GLFW_KEY_F11) == GLFW_PRESS);
+    if (fullscreen_key_down && !fullscreen_key && SetFullscreen(window, glfwGetWindowMonitor(window) == nullptr, windowed))
+    {
+      std::cout << "Failed to toggle fullscreen" << std::endl;
+    }
+    fullscreen_key = fullscreen_key_down;
+    int window_width = 0;
+    int window_height = 0;
+    glfwGetFramebufferSize(window, &window_width, &window_height);
+    // Where the frame is on screen, for mapping the mouse to the picture
+    DISPLAY_TRANSFORM display_transform = GetDisplayTransform(frame_buffer ? frame_buffer->width_ : 0, frame_buffer ? frame_buffer->height_ : 0, window_width, window_height, DISPLAY_SCALINGS[display_scaling_index].first, roi);
+    // ImGui window, rendered into the overlay first so the default frame buffer is only bound once
+    if (!kiosk && overlay.Begin(window_width, window_height))
     {
       bool clear_egl = false;
+      bool verify_shader = false;
       ImGui_ImplOpenGL3_NewFrame();
       ImGui_ImplGlfw_NewFrame();
       ImGui::NewFrame();
-      ImGui::Begin("Controller", &show_window, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoResize);
-      // Color spaces
-      ImGui::Text("MPP Colour Space: %s", GetColourSpaceText(mpp_colour_space));
-      ImGui::Text("MPP Colour Range: %s", GetColourRangeText(mpp_colour_range));
-      ImGui::Text("MPP Colour Primaries: %s", GetColourPrimariesText(mpp_colour_primaries));
-      if (ImGui::Combo("EGL Colour Space Override", &egl_colour_space_override_index, [](void*, int index){ return (EGL_COLOUR_SPACES[index].second.data()); }, nullptr, EGL_COLOUR_SPACES.size()))
+      // The wheel zooms around the cursor, dragging pans and double clicking goes back to the whole picture
+      if (!ImGui::GetIO().WantCaptureMouse)
       {
-        clear_egl = true;
+        const ImVec2 scale = ImGui::GetIO().DisplayFramebufferScale;
+        if (ImGui::GetIO().MouseWheel != 0.0f)
+        {
+          ZoomDisplayROI(roi, display_transform, std::pow(1.25f, ImGui::GetIO().MouseWheel), ImGui::GetIO().MousePos.x * scale.x, ImGui::GetIO().MousePos.y * scale.y, window_width, window_height);
+        }
+        else if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left))
+        {
+          roi = DISPLAY_ROI();
+        }
+        else if (ImGui::IsMouseDragging(ImGuiMouseButton_Left))
+        {
+          PanDisplayROI(roi, display_transform, ImGui::GetIO().MouseDelta.x * scale.x, ImGui::GetIO().MouseDelta.y * scale.y, window_width, window_height);
+        }
       }
-      if (ImGui::Combo("EGL Colour Range Override", &egl_colour_range_override_index, [](void*, int index){ return (EGL_COLOUR_RANGES[index].second.data()); }, nullptr, EGL_COLOUR_RANGES.size()))
+      if (show_window)
       {
-        clear_egl = true;
+        ImGui::Begin("Controller", &show_window, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoResize);
+        // Color spaces
+        ImGui::Text("MPP Colour Space: %s", GetColourSpaceText(mpp_colour_space));
+        ImGui::Text("MPP Colour Range: %s", GetColourRangeText(mpp_colour_range));
+        ImGui::Text("MPP Colour Primaries: %s", GetColourPrimariesText(mpp_colour_primaries));
+        if (ImGui::Combo("Colour Conversion", &colour_conversion_index, [](void*, int index){ return (COLOUR_CONVERSIONS[index].data()); }, nullptr, COLOUR_CONVERSIONS.size()))
+        {
+          shader_colour = (colour_conversion_index == 1);
+          clear_egl = true;
+        }
+        // The shader picks up overrides through its uniforms, only EGL needs the images recreating
+        if (ImGui::Combo("EGL Colour Space Override", &egl_colour_space_override_index, [](void*, int index){ return (EGL_COLOUR_SPACES[index].second.data()); }, nullptr, EGL_COLOUR_SPACES.size()) && !shader_colour)
+        {
+          clear_egl = true;
+        }
+        if (ImGui::Combo("EGL Colour Range Override", &egl_colour_range_override_index, [](void*, int index){ return (EGL_COLOUR_RANGES[index].second.data()); }, nullptr, EGL_COLOUR_RANGES.size()) && !shader_colour)
+        {
+          clear_egl = true;
+        }
+        if (ImGui::Button("Verify Shader"))
+        {
+          verify_shader = true;
+        }
+        if (shader_verify_error.is_initialized())
+        {
+          ImGui::SameLine();
+          ImGui::Text("Max error against CPU: %d", *shader_verify_error);
+        }
+        // Scaler
+        ImGui::Separator();
+        if (ImGui::Combo("Scaler", &scaler_index, [](void*, int index){ return (SCALER_TYPES[index].second.data()); }, nullptr, SCALER_TYPES.size()))
+        {
+          DestroyEGLFrames(egl_destroy_image_khr, egl_images); // Some of these may refer to the old pool
+          scaler = CreateScaler(SCALER_TYPES[scaler_index].first);
+          scaler_time = 0.0;
+        }
+        ImGui::Combo("Scaler Output", &scaler_format_index, [](void*, int index){ return (SCALER_FORMATS[index].second.data()); }, nullptr, SCALER_FORMATS.size());
+        if (scaler)
+        {
+          ImGui::Text("Scaler: %ux%u %.2fms", scaler->GetWidth(), scaler->GetHeight(), scaler_time);
+        }
+        // Software decoding
+        if (software)
+        {
+          ImGui::Separator();
+          ImGui::Text("Software Decoder: %lu frames", software_decoder.GetDecoded());
+          ImGui::Text("Upload: %.2fms %.0fMB/s, %lu stalls", texture_upload.GetUploadTime(), texture_upload.GetBandwidth(), texture_upload.GetStalls());
+        }
+        // Errors
+        ImGui::Separator();
+        ImGui::Text("Errors: %lu, %lu damaged frames, %lu resets, %lu packets skipped", recovery.GetErrors(), software ? software_decoder.GetDamaged() : mpp_decoder.GetDamaged(), recovery.GetResets(), recovery.GetSkipped());
+        ImGui::Text("Recovery: %lu, last %.0fms, max %.0fms%s", recovery.GetRecoveries(), recovery.GetLastRecoveryTime(), recovery.GetMaxRecoveryTime(), recovery.IsResyncing() ? " (resyncing)" : "");
+        // Snapshots
+        ImGui::Separator();
+        if (ImGui::Button("Snapshot") && frame_buffer)
+        {
+          snapshot.Capture(frame_buffer->frame_, frame_buffer->width_, frame_buffer->height_, SNAPSHOT_FORMATS[snapshot_format_index].first);
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Burst", &snapshot_burst);
+        ImGui::Combo("Snapshot Format", &snapshot_format_index, [](void*, int index){ return (SNAPSHOT_FORMATS[index].second.data()); }, nullptr, SNAPSHOT_FORMATS.size());
+        ImGui::Text("Snapshots: %u saved, %zu queued, %u dropped, %u failed", snapshot.GetSaved(), snapshot.GetQueued(), snapshot.GetDropped(), snapshot.GetFailed());
+        // Recording
+        ImGui::Separator();
+        if (recorder.IsRecording())
+        {
+          if (ImGui::Button("Stop Recording"))
+          {
+            recorder.Stop();
+          }
+        }
+        else if (ImGui::Button("Record"))
+        {
+          recorder.Start();
+        }
+        ImGui::Text("Pre-event: %.1fs %.1fMB", recorder.GetPreEventDuration(), recorder.GetPreEventBytes() / (1024.0 * 1024.0));
+        ImGui::Text("Recording: %u segments, %lu packets %.1fMB, %.1fMB queued", recorder.GetSegments(), recorder.GetWritten(), recorder.GetWrittenBytes() / (1024.0 * 1024.0), recorder.GetQueuedBytes() / (1024.0 * 1024.0));
+        ImGui::Text("Recording: %lu dropped, %u failed", recorder.GetDropped(), recorder.GetFailed());
+        // Export
+        if (export_path.size())
+        {
+          ImGui::Separator();
+          ImGui::Text("Export: %u subscribers, %zu outstanding", frame_export.GetSubscribers(), frame_export.GetOutstanding());
+          ImGui::Text("Export: %lu sent, %lu skipped", frame_export.GetSent(), frame_export.GetSkipped());
+        }
+        // Display
+        ImGui::Separator();
+        ImGui::Combo("Scaling", &display_scaling_index, [](void*, int index){ return (DISPLAY_SCALINGS[index].second.data()); }, nullptr, DISPLAY_SCALINGS.size());
+        if (ImGui::SliderFloat("Zoom", &roi.zoom_, 1.0f, DISPLAY_MAX_ZOOM, "%.1fx"))
+        {
+          ClampDisplayROI(roi);
+        }
+        bool window_fullscreen = (glfwGetWindowMonitor(window) != nullptr);
+        if (ImGui::Checkbox("Fullscreen", &window_fullscreen) && SetFullscreen(window, window_fullscreen, windowed))
+        {
+          std::cout << "Failed to toggle fullscreen" << std::endl;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Reset View"))
+        {
+          roi = DISPLAY_ROI();
+        }
+        // Memory
+        ImGui::Separator();
+        ShowMemory(memory);
+        // Overlay
+        ImGui::Separator();
+        ImGui::Text("Frame: %.2fms, overlay %.2fms, %lu rendered, %lu cached", frame_time, overlay.GetRenderTime(), overlay.GetRendered(), overlay.GetCached());
+        ImGui::End();
       }
-      ImGui::End();
       ImGui::EndFrame();
       // ImGui Render
       ImGui::Render();
       ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+      overlay.End();
+      // The verification draws into its own frame buffer, so it waits until the overlay is finished
+      if (verify_shader)
+      {
+        int max_error = 0;
+        if (VerifyYUVShader(nv12_shader_program, vao, nv12_luma_location, nv12_chroma_location, nv12_matrix_location, nv12_offset_location, GetYUVMatrix(GetYUVColourSpace(EGL_COLOUR_SPACES[egl_colour_space_override_index].first), EGL_COLOUR_RANGES[egl_colour_range_override_index].first == EGL_YUV_FULL_RANGE_EXT), max_error) == 0)
+        {
+          shader_verify_error = max_error;
+        }
+        overlay.Invalidate();
+      }
       // Refresh EGL images if we have changed settings
       if (clear_egl)
       {
         DestroyEGLFrames(egl_destroy_image_khr, egl_images);
       }
     }
+    // Clear, then draw the video and the overlay in one pass
+    GL_CHECK(glViewport(0, 0, window_width, window_height));
+    GL_CHECK(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+    GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
+    if (frame_buffer)
+    {
+      // Draw the frame, the scaling, crop and zoom are all in the vertex transform so there is no intermediate rescale
+      display_transform = GetDisplayTransform(frame_buffer->width_, frame_buffer->height_, window_width, window_height, DISPLAY_SCALINGS[display_scaling_index].first, roi);
+      GL_CHECK(glUseProgram(display_shader_program));
+      GL_CHECK(glUniform4fv(display_position_location, 1, display_transform.position_));
+      GL_CHECK(glUniform4fv(display_texcoord_location, 1, display_transform.texcoord_));
+      // Textures
+      GL_CHECK(glActiveTexture(GL_TEXTURE0));
+      GL_CHECK(glUniform1i(display_sampler_location, 0));
+      GL_CHECK(glBindTexture(GL_TEXTURE_2D, frame_buffer->texture_));
+      // Draw elements
+      GL_CHECK(glBindVertexArray(vao));
+      GL_CHECK(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
+      // Cleanup
+      GL_CHECK(glBindVertexArray(0));
+      GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+      GL_CHECK(glUseProgram(0));
+      GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    }
+    if (show_window)
+    {
+      overlay.Draw(shader_program, texture_sampler_location, vao);
+    }
+    const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
+    frame_time = (frame_time == 0.0) ? elapsed : ((frame_time * 0.9) + (elapsed * 0.1));
+    // Hand any completed snapshot readbacks to the encoder
+    snapshot.Poll();
     // Display render
     glfwSwapBuffers(window);
     // Delay loop
     std::this_thread::sleep_for(std::chrono::milliseconds(10));
   }
   // Clear up
+  std::cout << "Frame time " << frame_time << "ms, overlay " << overlay.GetRendered() << " rendered " << overlay.GetCached() << " cached" << std::endl;
+  PrintMemory(memory);
   DestroyEGLFrames(egl_destroy_image_khr, egl_images);
   frame_buffer.reset();
+  scaler.reset();
+  texture_upload.Destroy();
+  snapshot.Destroy();
+  recorder.Destroy();
+  frame_export.Destroy();
   return 0;
 }
 
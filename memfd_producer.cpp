@@ -0,0 +1,133 @@
+#include "memfd_producer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <drm/drm_fourcc.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+MEMFD_PRODUCER::MEMFD_PRODUCER()
+  : width_(0)
+  , height_(0)
+  , hor_stride_(0)
+  , ver_stride_(0)
+  , size_(0)
+  , produced_(0)
+  , starved_(0)
+{
+}
+
+MEMFD_PRODUCER::~MEMFD_PRODUCER()
+{
+  Destroy();
+}
+
+int MEMFD_PRODUCER::Init(const uint32_t width, const uint32_t height, const size_t buffers)
+{
+  Destroy();
+  if ((width == 0) || (height == 0) || (buffers == 0))
+  {
+    std::cout << "Invalid memfd producer parameters" << std::endl;
+    return -1;
+  }
+  // Match the 16 pixel alignment MPP gives decoded frames so consumers see the same layout
+  width_ = width;
+  height_ = height;
+  hor_stride_ = (width + 15) & ~15;
+  ver_stride_ = (height + 15) & ~15;
+  size_ = (hor_stride_ * ver_stride_ * 3) / 2;
+  for (size_t i = 0; i < buffers; ++i)
+  {
+    const int fd = memfd_create("RockchipPlayer", MFD_CLOEXEC);
+    if (fd == -1)
+    {
+      std::cout << "Failed to create memfd" << std::endl;
+      Destroy();
+      return -2;
+    }
+    if (ftruncate(fd, size_))
+    {
+      std::cout << "Failed to size memfd" << std::endl;
+      close(fd);
+      Destroy();
+      return -3;
+    }
+    void* ptr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED)
+    {
+      std::cout << "Failed to map memfd" << std::endl;
+      close(fd);
+      Destroy();
+      return -4;
+    }
+    buffers_.push_back(MEMFD_BUFFER(fd, reinterpret_cast<uint8_t*>(ptr)));
+  }
+  return 0;
+}
+
+void MEMFD_PRODUCER::Destroy()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (MEMFD_BUFFER& buffer : buffers_)
+  {
+    munmap(buffer.ptr_, size_);
+    close(buffer.fd_);
+  }
+  buffers_.clear();
+}
+
+int MEMFD_PRODUCER::Produce(FRAME_EXPORT& frame_export, const int64_t pts)
+{
+  size_t index = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<MEMFD_BUFFER>::iterator buffer = std::find_if(buffers_.begin(), buffers_.end(), [](const MEMFD_BUFFER& buffer){ return !buffer.in_use_; });
+    if (buffer == buffers_.end())
+    {
+      // Subscribers are holding every buffer, just like the decoder would stall
+      ++starved_;
+      return 1;
+    }
+    buffer->in_use_ = true;
+    index = std::distance(buffers_.begin(), buffer);
+  }
+  // Luma ramp that scrolls with time and a flat chroma plane
+  uint8_t* ptr = buffers_[index].ptr_;
+  for (uint32_t y = 0; y < height_; ++y)
+  {
+    uint8_t* row = ptr + (y * hor_stride_);
+    for (uint32_t x = 0; x < width_; ++x)
+    {
+      row[x] = static_cast<uint8_t>(x + y + pts);
+    }
+  }
+  std::memset(ptr + (hor_stride_ * ver_stride_), 128, hor_stride_ * (ver_stride_ / 2));
+  FRAME_EXPORT_FRAME header;
+  std::memset(&header, 0, sizeof(header));
+  header.pts_ = pts;
+  header.time_base_num_ = 1;
+  header.time_base_den_ = 1000;
+  header.width_ = width_;
+  header.height_ = height_;
+  header.drm_format_ = DRM_FORMAT_NV12;
+  header.plane_count_ = 2;
+  header.planes_[0].offset_ = 0;
+  header.planes_[0].pitch_ = hor_stride_;
+  header.planes_[1].offset_ = hor_stride_ * ver_stride_;
+  header.planes_[1].pitch_ = hor_stride_;
+  header.size_ = size_;
+  header.colour_space_ = FRAME_EXPORT_COLOUR_SPACE_BT709;
+  header.colour_range_ = FRAME_EXPORT_COLOUR_RANGE_LIMITED;
+  header.colour_primaries_ = FRAME_EXPORT_COLOUR_PRIMARIES_BT709;
+  ++produced_;
+  frame_export.Publish(header, buffers_[index].fd_, [this, index]()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index < buffers_.size())
+    {
+      buffers_[index].in_use_ = false;
+    }
+  });
+  return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "frame_export.hpp"
+
+struct MEMFD_BUFFER
+{
+  MEMFD_BUFFER(const int fd, uint8_t* ptr)
+    : fd_(fd)
+    , ptr_(ptr)
+    , in_use_(false)
+  {
+  }
+
+  int fd_;
+  uint8_t* ptr_;
+  bool in_use_;
+
+};
+
+// Stands in for the decoder when there is no Rockchip hardware, producing NV12 frames in memfd buffers for the frame export
+class MEMFD_PRODUCER
+{
+ public:
+
+  MEMFD_PRODUCER();
+  ~MEMFD_PRODUCER();
+
+  int Init(const uint32_t width, const uint32_t height, const size_t buffers);
+  void Destroy();
+
+  int Produce(FRAME_EXPORT& frame_export, const int64_t pts);
+
+  uint64_t GetProduced() const { return produced_; }
+  uint64_t GetStarved() const { return starved_; }
+
+ private:
+
+  std::mutex mutex_;
+  std::vector<MEMFD_BUFFER> buffers_;
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t hor_stride_;
+  uint32_t ver_stride_;
+  size_t size_;
+  uint64_t produced_;
+  uint64_t starved_;
+
+};
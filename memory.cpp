@@ -0,0 +1,201 @@
+#include "memory.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+uint64_t MEMORY_STREAM::GetBytes() const
+{
+  uint64_t bytes = 0;
+  for (size_t category = 0; category < MEMORY_CATEGORY_COUNT; ++category)
+  {
+    if (IsMemoryCategoryCounted(static_cast<MEMORY_CATEGORY>(category)))
+    {
+      bytes += usage_[category].bytes_;
+    }
+  }
+  return bytes;
+}
+
+const char* GetMemoryCategoryText(const MEMORY_CATEGORY category)
+{
+  switch (category)
+  {
+    case MEMORY_CATEGORY::MPP_BUFFERS:
+    {
+      return "MPP Buffers";
+    }
+    case MEMORY_CATEGORY::EGL_IMAGES:
+    {
+      return "EGL Images";
+    }
+    case MEMORY_CATEGORY::FRAME_BUFFERS:
+    {
+      return "Frame Buffers";
+    }
+    case MEMORY_CATEGORY::PACKETS:
+    {
+      return "Packets";
+    }
+  }
+  return "Unknown";
+}
+
+bool IsMemoryCategoryCounted(const MEMORY_CATEGORY category)
+{
+  return (category != MEMORY_CATEGORY::EGL_IMAGES);
+}
+
+uint64_t EstimateStreamMemory(const int width, const int height)
+{
+  // NV12 at the decoder's 16 pixel alignment
+  const uint64_t hor_stride = (static_cast<uint64_t>(std::max(width, 0)) + 15) & ~static_cast<uint64_t>(15);
+  const uint64_t ver_stride = (static_cast<uint64_t>(std::max(height, 0)) + 15) & ~static_cast<uint64_t>(15);
+  return ((hor_stride * ver_stride * 3) / 2) * MEMORY_ESTIMATED_FRAMES;
+}
+
+MEMORY::MEMORY()
+  : limit_(0)
+  , next_stream_(0)
+  , peak_bytes_(0)
+  , refused_(0)
+{
+}
+
+MEMORY::~MEMORY()
+{
+}
+
+void MEMORY::SetLimit(const uint64_t limit)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  limit_ = limit;
+}
+
+int MEMORY::Open(const std::string& name, const uint64_t estimate)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (limit_ && ((GetCommitted() + estimate) > limit_))
+  {
+    ++refused_;
+    std::cout << "Refusing to open " << name << ", it needs about " << (estimate / (1024 * 1024)) << "MB and " << (GetCommitted() / (1024 * 1024)) << "MB of " << (limit_ / (1024 * 1024)) << "MB is committed" << std::endl;
+    return -1;
+  }
+  const int stream = next_stream_++;
+  streams_.insert(std::make_pair(stream, MEMORY_STREAM(name, estimate)));
+  return stream;
+}
+
+void MEMORY::Close(const int stream)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<int, MEMORY_STREAM>::iterator s = streams_.find(stream);
+  if (s == streams_.end())
+  {
+    return;
+  }
+  for (size_t category = 0; category < MEMORY_CATEGORY_COUNT; ++category)
+  {
+    totals_[category].bytes_ -= s->second.usage_[category].bytes_;
+    totals_[category].count_ -= s->second.usage_[category].count_;
+  }
+  streams_.erase(s);
+}
+
+void MEMORY::Set(const int stream, const MEMORY_CATEGORY category, const uint64_t bytes, const uint64_t count)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<int, MEMORY_STREAM>::iterator s = streams_.find(stream);
+  if (s == streams_.end())
+  {
+    return;
+  }
+  MEMORY_USAGE& usage = s->second.usage_[static_cast<size_t>(category)];
+  MEMORY_USAGE& total = totals_[static_cast<size_t>(category)];
+  total.bytes_ = total.bytes_ - usage.bytes_ + bytes;
+  total.count_ = total.count_ - usage.count_ + count;
+  usage.bytes_ = bytes;
+  usage.count_ = count;
+  usage.peak_bytes_ = std::max(usage.peak_bytes_, bytes);
+  usage.peak_count_ = std::max(usage.peak_count_, count);
+  total.peak_bytes_ = std::max(total.peak_bytes_, total.bytes_);
+  total.peak_count_ = std::max(total.peak_count_, total.count_);
+  peak_bytes_ = std::max(peak_bytes_, GetTotalBytesLocked());
+}
+
+void MEMORY::ResetPeaks()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (std::pair<const int, MEMORY_STREAM>& stream : streams_)
+  {
+    for (MEMORY_USAGE& usage : stream.second.usage_)
+    {
+      usage.peak_bytes_ = usage.bytes_;
+      usage.peak_count_ = usage.count_;
+    }
+  }
+  for (MEMORY_USAGE& total : totals_)
+  {
+    total.peak_bytes_ = total.bytes_;
+    total.peak_count_ = total.count_;
+  }
+  peak_bytes_ = GetTotalBytesLocked();
+}
+
+MEMORY_USAGE MEMORY::GetTotal(const MEMORY_CATEGORY category)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return totals_[static_cast<size_t>(category)];
+}
+
+uint64_t MEMORY::GetTotalBytes()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return GetTotalBytesLocked();
+}
+
+uint64_t MEMORY::GetPeakBytes()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return peak_bytes_;
+}
+
+uint64_t MEMORY::GetRefused()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return refused_;
+}
+
+std::vector<MEMORY_STREAM> MEMORY::GetStreams()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<MEMORY_STREAM> streams;
+  for (const std::pair<const int, MEMORY_STREAM>& stream : streams_)
+  {
+    streams.push_back(stream.second);
+  }
+  return streams;
+}
+
+uint64_t MEMORY::GetTotalBytesLocked() const
+{
+  uint64_t bytes = 0;
+  for (size_t category = 0; category < MEMORY_CATEGORY_COUNT; ++category)
+  {
+    if (IsMemoryCategoryCounted(static_cast<MEMORY_CATEGORY>(category)))
+    {
+      bytes += totals_[category].bytes_;
+    }
+  }
+  return bytes;
+}
+
+uint64_t MEMORY::GetCommitted() const
+{
+  // Streams count at their estimate until they have allocated more than it
+  uint64_t committed = 0;
+  for (const std::pair<const int, MEMORY_STREAM>& stream : streams_)
+  {
+    committed += std::max(stream.second.estimate_, stream.second.GetBytes());
+  }
+  return committed;
+}
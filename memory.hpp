@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum class MEMORY_CATEGORY
+{
+  MPP_BUFFERS, // The decoder's and scaler's DRM buffer groups, which are CMA on most boards
+  EGL_IMAGES, // dma-bufs held by imported images. They are MPP buffers already counted above, so are shown but left out of totals and the limit
+  FRAME_BUFFERS, // GL render targets
+  PACKETS // Compressed data waiting to be decoded or recorded
+};
+
+const size_t MEMORY_CATEGORY_COUNT = 4;
+// A decoder typically settles on about this many frame buffers for H264, which is what a new stream is assumed to need until it has allocated
+const uint64_t MEMORY_ESTIMATED_FRAMES = 20;
+
+struct MEMORY_USAGE
+{
+  MEMORY_USAGE()
+    : bytes_(0)
+    , count_(0)
+    , peak_bytes_(0)
+    , peak_count_(0)
+  {
+  }
+
+  uint64_t bytes_;
+  uint64_t count_;
+  uint64_t peak_bytes_;
+  uint64_t peak_count_;
+
+};
+
+struct MEMORY_STREAM
+{
+  MEMORY_STREAM(const std::string& name, const uint64_t estimate)
+    : name_(name)
+    , estimate_(estimate)
+  {
+  }
+
+  uint64_t GetBytes() const;
+
+  std::string name_;
+  uint64_t estimate_; // Held against the limit until the stream actually uses more
+  std::array<MEMORY_USAGE, MEMORY_CATEGORY_COUNT> usage_;
+
+};
+
+const char* GetMemoryCategoryText(const MEMORY_CATEGORY category);
+// Whether the category adds to stream and overall totals
+bool IsMemoryCategoryCounted(const MEMORY_CATEGORY category);
+// What a decoder will allocate for its frame buffers at this resolution
+uint64_t EstimateStreamMemory(const int width, const int height);
+
+// Keeps current and high-water bytes and object counts per category and per stream. The owners report their absolute usage, so nothing drifts if an update is missed
+// With a limit set a new stream is refused if it would take the total over, rather than letting an existing stream fail to allocate later
+class MEMORY
+{
+ public:
+
+  MEMORY();
+  ~MEMORY();
+
+  void SetLimit(const uint64_t limit); // Bytes, 0 for no limit
+  // Returns the stream or -1 if the limit would be exceeded
+  int Open(const std::string& name, const uint64_t estimate);
+  void Close(const int stream);
+  void Set(const int stream, const MEMORY_CATEGORY category, const uint64_t bytes, const uint64_t count);
+  // Starts the high-water marks again from current usage
+  void ResetPeaks();
+
+  uint64_t GetLimit() const { return limit_; }
+  MEMORY_USAGE GetTotal(const MEMORY_CATEGORY category);
+  uint64_t GetTotalBytes();
+  uint64_t GetPeakBytes();
+  uint64_t GetRefused();
+  std::vector<MEMORY_STREAM> GetStreams();
+
+ private:
+
+  uint64_t GetTotalBytesLocked() const;
+  uint64_t GetCommitted() const;
+
+  uint64_t limit_;
+  std::mutex mutex_;
+  int next_stream_;
+  std::map<int, MEMORY_STREAM> streams_;
+  std::array<MEMORY_USAGE, MEMORY_CATEGORY_COUNT> totals_;
+  uint64_t peak_bytes_;
+  uint64_t refused_;
+
+};
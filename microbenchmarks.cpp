@@ -0,0 +1,273 @@
+#include <benchmark/benchmark.h>
+#include <boost/scope_exit.hpp>
+#include <cstring>
+#include <drm/drm_fourcc.h>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include "bitstream.hpp"
+#include "egl_image.hpp"
+
+// Packets and extradata taken from a real file given on the command line
+std::vector<std::vector<uint8_t>> real_packets;
+std::vector<uint8_t> real_extradata;
+
+static std::vector<uint8_t> MakeAVCCPacket(const size_t nal_count, const size_t nal_size)
+{
+  std::vector<uint8_t> packet;
+  for (size_t i = 0; i < nal_count; ++i)
+  {
+    packet.push_back((nal_size >> 24) & 0xff);
+    packet.push_back((nal_size >> 16) & 0xff);
+    packet.push_back((nal_size >> 8) & 0xff);
+    packet.push_back(nal_size & 0xff);
+    packet.insert(packet.end(), nal_size, static_cast<uint8_t>(i));
+  }
+  return packet;
+}
+
+// avcC with a 1080p sized SPS and PPS
+static std::vector<uint8_t> MakeAVCCExtradata()
+{
+  std::vector<uint8_t> extradata = { 1, 0x64, 0x00, 0x28, 0xff, 0xe1, 0x00, 25 };
+  extradata.insert(extradata.end(), 25, 0x67);
+  extradata.insert(extradata.end(), { 1, 0x00, 4 });
+  extradata.insert(extradata.end(), 4, 0x68);
+  return extradata;
+}
+
+static int LoadPackets(const std::string& path)
+{
+  AVFormatContext* format_context = nullptr;
+  if (avformat_open_input(&format_context, path.c_str(), nullptr, nullptr) != 0)
+  {
+    std::cout << "Failed to open avformat file: " << path << std::endl;
+    return -1;
+  }
+  BOOST_SCOPE_EXIT(&format_context)
+  {
+    avformat_close_input(&format_context);
+  }
+  BOOST_SCOPE_EXIT_END
+  if (avformat_find_stream_info(format_context, nullptr) < 0)
+  {
+    std::cout << "Failed to find stream info: " << path << std::endl;
+    return -2;
+  }
+  int stream = -1;
+  for (unsigned int i = 0; i < format_context->nb_streams; i++)
+  {
+    if ((format_context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) && (format_context->streams[i]->codecpar->codec_id == AVCodecID::AV_CODEC_ID_H264))
+    {
+      stream = i;
+      break;
+    }
+  }
+  if (stream < 0)
+  {
+    std::cout << "Failed to find H264 stream: " << path << std::endl;
+    return -3;
+  }
+  const AVCodecParameters* codecpar = format_context->streams[stream]->codecpar;
+  if (codecpar->extradata && codecpar->extradata_size)
+  {
+    real_extradata.assign(codecpar->extradata, codecpar->extradata + codecpar->extradata_size);
+  }
+  AVPacket* packet = av_packet_alloc();
+  BOOST_SCOPE_EXIT(&packet)
+  {
+    av_packet_free(&packet);
+  }
+  BOOST_SCOPE_EXIT_END
+  // A GOP or few is plenty, and keeps the working set about the size the player sees
+  while ((real_packets.size() < 500) && (av_read_frame(format_context, packet) == 0))
+  {
+    if (packet->stream_index == stream)
+    {
+      real_packets.push_back(std::vector<uint8_t>(packet->data, packet->data + packet->size));
+    }
+    av_packet_unref(packet);
+  }
+  std::cout << "Loaded " << real_packets.size() << " packets from " << path << std::endl;
+  return 0;
+}
+
+static void BM_SplitAVCCPacket(benchmark::State& state)
+{
+  const std::vector<uint8_t> packet = MakeAVCCPacket(state.range(0), state.range(1));
+  std::vector<H264_NAL> nals;
+  for (auto _ : state)
+  {
+    SplitAVCCPacket(packet.data(), packet.size(), nals);
+    benchmark::DoNotOptimize(nals.data());
+  }
+  state.SetBytesProcessed(state.iterations() * packet.size());
+}
+BENCHMARK(BM_SplitAVCCPacket)->Args({ 1, 64 * 1024 })->Args({ 4, 16 * 1024 })->Args({ 32, 1024 });
+
+static void BM_SplitAVCCPacketReal(benchmark::State& state)
+{
+  std::vector<H264_NAL> nals;
+  size_t bytes = 0;
+  for (auto _ : state)
+  {
+    for (const std::vector<uint8_t>& packet : real_packets)
+    {
+      SplitAVCCPacket(packet.data(), packet.size(), nals);
+      benchmark::DoNotOptimize(nals.data());
+      bytes += packet.size();
+    }
+  }
+  state.SetBytesProcessed(bytes);
+}
+
+static void BM_WriteAnnexBNAL(benchmark::State& state)
+{
+  const std::vector<uint8_t> nal(state.range(0), 0x41);
+  std::vector<uint8_t> buffer(nal.size() + sizeof(H264_START_SEQUENCE));
+  for (auto _ : state)
+  {
+    WriteAnnexBNAL(nal.data(), nal.size(), buffer.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * nal.size());
+}
+BENCHMARK(BM_WriteAnnexBNAL)->Arg(1024)->Arg(64 * 1024)->Arg(1024 * 1024);
+
+// What the decoder used to do, mpp_packet_write copied the buffer into the packet after the NAL had been written into it
+static void BM_WriteAnnexBNALPacketWrite(benchmark::State& state)
+{
+  const std::vector<uint8_t> nal(state.range(0), 0x41);
+  std::vector<uint8_t> buffer(nal.size() + sizeof(H264_START_SEQUENCE));
+  std::vector<uint8_t> packet(buffer.size());
+  for (auto _ : state)
+  {
+    WriteAnnexBNAL(nal.data(), nal.size(), buffer.data());
+    std::memcpy(packet.data(), buffer.data(), buffer.size());
+    benchmark::DoNotOptimize(packet.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * nal.size());
+}
+BENCHMARK(BM_WriteAnnexBNALPacketWrite)->Arg(1024)->Arg(64 * 1024)->Arg(1024 * 1024);
+
+static void BM_ParseAVCCExtradata(benchmark::State& state)
+{
+  const std::vector<uint8_t> extradata = real_extradata.size() ? real_extradata : MakeAVCCExtradata();
+  std::vector<uint8_t> spspps;
+  std::cout.setstate(std::ios::failbit); // The parse logs what it finds
+  for (auto _ : state)
+  {
+    ParseAVCCExtradata(extradata.data(), extradata.size(), spspps);
+    benchmark::DoNotOptimize(spspps.data());
+  }
+  std::cout.clear();
+}
+BENCHMARK(BM_ParseAVCCExtradata);
+
+// The per frame lookup of EGL images by MPP buffer, with as many entries as the decoder and scaler pools hold
+static void BM_EGLImagesMapFind(benchmark::State& state)
+{
+  std::vector<std::unique_ptr<int>> buffers;
+  std::map<void*, int> images;
+  for (int64_t i = 0; i < state.range(0); ++i)
+  {
+    buffers.push_back(std::make_unique<int>(i));
+    images.insert(std::make_pair(buffers.back().get(), i));
+  }
+  size_t i = 0;
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(images.find(buffers[i].get()));
+    i = (i + 1) % buffers.size();
+  }
+}
+BENCHMARK(BM_EGLImagesMapFind)->Arg(4)->Arg(16)->Arg(32);
+
+static void BM_EGLImagesUnorderedMapFind(benchmark::State& state)
+{
+  std::vector<std::unique_ptr<int>> buffers;
+  std::unordered_map<void*, int> images;
+  for (int64_t i = 0; i < state.range(0); ++i)
+  {
+    buffers.push_back(std::make_unique<int>(i));
+    images.insert(std::make_pair(buffers.back().get(), i));
+  }
+  size_t i = 0;
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(images.find(buffers[i].get()));
+    i = (i + 1) % buffers.size();
+  }
+}
+BENCHMARK(BM_EGLImagesUnorderedMapFind)->Arg(4)->Arg(16)->Arg(32);
+
+static void BM_GetEGLImageAttributes(benchmark::State& state)
+{
+  const EGL_IMAGE_PLANE planes[] = { { 0, 1920 }, { 1920 * 1088, 1920 } };
+  EGLint attributes[EGL_IMAGE_MAX_ATTRIBUTES];
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(GetEGLImageAttributes(attributes, 10, 1920, 1080, DRM_FORMAT_NV12, planes, 2, EGL_ITU_REC709_EXT, EGL_YUV_NARROW_RANGE_EXT));
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_GetEGLImageAttributes);
+
+// How the attributes were built before, for comparison
+static void BM_EGLImageAttributesVector(benchmark::State& state)
+{
+  for (auto _ : state)
+  {
+    std::vector<EGLint> attributes =
+    {
+      EGL_WIDTH, 1920,
+      EGL_HEIGHT, 1080,
+      EGL_LINUX_DRM_FOURCC_EXT, static_cast<EGLint>(DRM_FORMAT_NV12),
+      EGL_DMA_BUF_PLANE0_FD_EXT, 10,
+      EGL_DMA_BUF_PLANE0_OFFSET_EXT, 0,
+      EGL_DMA_BUF_PLANE0_PITCH_EXT, 1920
+    };
+    attributes.insert(attributes.end(),
+    {
+      EGL_DMA_BUF_PLANE1_FD_EXT, 10,
+      EGL_DMA_BUF_PLANE1_OFFSET_EXT, 1920 * 1088,
+      EGL_DMA_BUF_PLANE1_PITCH_EXT, 1920,
+      EGL_YUV_COLOR_SPACE_HINT_EXT, EGL_ITU_REC709_EXT,
+      EGL_SAMPLE_RANGE_HINT_EXT, EGL_YUV_NARROW_RANGE_EXT
+    });
+    attributes.push_back(EGL_NONE);
+    benchmark::DoNotOptimize(attributes.data());
+  }
+}
+BENCHMARK(BM_EGLImageAttributesVector);
+
+int main(int argc, char** argv)
+{
+  benchmark::Initialize(&argc, argv);
+  // Anything Google Benchmark did not recognise is a file to take real packets from
+  for (int i = 1; i < argc; ++i)
+  {
+    if (LoadPackets(argv[i]))
+    {
+      return -1;
+    }
+  }
+  if (real_packets.size())
+  {
+    benchmark::RegisterBenchmark("BM_SplitAVCCPacketReal", BM_SplitAVCCPacketReal);
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
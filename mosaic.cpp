@@ -0,0 +1,704 @@
+#include "mosaic.hpp"
+
+#include <algorithm>
+#include <boost/scope_exit.hpp>
+#include <cmath>
+#include <drm/drm_fourcc.h>
+#include <iostream>
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+}
+
+#include "egl_image.hpp"
+
+// Find the H264 stream the VPU can decode, and how big and fast it is
+static int ProbeSource(const std::string& path, uint32_t& width, uint32_t& height, double& fps)
+{
+  AVFormatContext* format_context = nullptr;
+  if (avformat_open_input(&format_context, path.c_str(), nullptr, nullptr) != 0)
+  {
+    std::cout << "Failed to open avformat file: " << path << std::endl;
+    return -1;
+  }
+  BOOST_SCOPE_EXIT(&format_context)
+  {
+    avformat_close_input(&format_context);
+  }
+  BOOST_SCOPE_EXIT_END
+  if (avformat_find_stream_info(format_context, nullptr) < 0)
+  {
+    std::cout << "Failed to find stream info: " << path << std::endl;
+    return -2;
+  }
+  for (unsigned int i = 0; i < format_context->nb_streams; i++)
+  {
+    const AVStream* stream = format_context->streams[i];
+    if ((stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) && (stream->codecpar->codec_id == AVCodecID::AV_CODEC_ID_H264))
+    {
+      width = stream->codecpar->width;
+      height = stream->codecpar->height;
+      fps = stream->avg_frame_rate.den ? av_q2d(stream->avg_frame_rate) : 0.0;
+      if (fps <= 0.0)
+      {
+        fps = 25.0;
+      }
+      return 0;
+    }
+  }
+  std::cout << "Failed to find video stream: " << path << std::endl;
+  return -3;
+}
+
+// Frames in any other format are dropped and counted rather than drawn
+static bool IsRenderable(MppFrame frame)
+{
+  return (mpp_frame_get_buffer(frame) && (mpp_frame_get_fmt(frame) == MPP_FMT_YUV420SP));
+}
+
+MOSAIC::MOSAIC()
+  : egl_create_image_khr_(nullptr)
+  , egl_destroy_image_khr_(nullptr)
+  , egl_create_sync_khr_(nullptr)
+  , egl_destroy_sync_khr_(nullptr)
+  , egl_client_wait_sync_khr_(nullptr)
+  , gl_egl_image_target_texture_2_does_(nullptr)
+  , oes_program_(0)
+  , oes_sampler_location_(-1)
+  , vao_(0)
+  , oes_texture_(0)
+  , memory_(nullptr)
+{
+}
+
+MOSAIC::~MOSAIC()
+{
+  Destroy();
+}
+
+int MOSAIC::Init(const std::vector<std::vector<std::string>>& tiles, MEMORY& memory, const GLuint oes_program, const GLint oes_sampler_location, const GLuint vao)
+{
+  Destroy();
+  egl_create_image_khr_ = reinterpret_cast<PFNEGLCREATEIMAGEKHRPROC>(eglGetProcAddress("eglCreateImageKHR"));
+  egl_destroy_image_khr_ = reinterpret_cast<PFNEGLDESTROYIMAGEKHRPROC>(eglGetProcAddress("eglDestroyImageKHR"));
+  egl_create_sync_khr_ = reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"));
+  egl_destroy_sync_khr_ = reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"));
+  egl_client_wait_sync_khr_ = reinterpret_cast<PFNEGLCLIENTWAITSYNCKHRPROC>(eglGetProcAddress("eglClientWaitSyncKHR"));
+  gl_egl_image_target_texture_2_does_ = reinterpret_cast<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC>(eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+  if ((egl_create_image_khr_ == nullptr) || (egl_destroy_image_khr_ == nullptr) || (egl_create_sync_khr_ == nullptr) || (egl_destroy_sync_khr_ == nullptr) || (egl_client_wait_sync_khr_ == nullptr) || (gl_egl_image_target_texture_2_does_ == nullptr))
+  {
+    std::cout << "Failed to retrieve EGL functions" << std::endl;
+    return -1;
+  }
+  if (tiles.empty())
+  {
+    std::cout << "Mosaic has no tiles" << std::endl;
+    return -2;
+  }
+  for (const std::vector<std::string>& paths : tiles)
+  {
+    std::unique_ptr<MOSAIC_TILE> tile = std::make_unique<MOSAIC_TILE>();
+    for (const std::string& path : paths)
+    {
+      uint32_t width = 0;
+      uint32_t height = 0;
+      double fps = 0.0;
+      if (ProbeSource(path, width, height, fps))
+      {
+        Destroy();
+        return -3;
+      }
+      tile->sources_.push_back(MOSAIC_SOURCE(path, width, height, fps));
+    }
+    std::sort(tile->sources_.begin(), tile->sources_.end(), [](const MOSAIC_SOURCE& lhs, const MOSAIC_SOURCE& rhs){ return ((static_cast<uint64_t>(lhs.width_) * lhs.height_) < (static_cast<uint64_t>(rhs.width_) * rhs.height_)); });
+    tiles_.push_back(std::move(tile));
+  }
+  memory_ = &memory;
+  oes_program_ = oes_program;
+  oes_sampler_location_ = oes_sampler_location;
+  vao_ = vao;
+  GL_CHECK(glGenTextures(1, &oes_texture_));
+  return 0;
+}
+
+void MOSAIC::Destroy()
+{
+  for (std::unique_ptr<MOSAIC_TILE>& tile : tiles_)
+  {
+    DestroyStream(tile->pending_);
+    DestroyStream(tile->active_);
+    tile->frame_buffer_.reset();
+  }
+  tiles_.clear();
+  if (oes_texture_)
+  {
+    GL_CHECK(glDeleteTextures(1, &oes_texture_));
+    oes_texture_ = 0;
+  }
+}
+
+int MOSAIC::Layout(const int width, const int height, const boost::optional<size_t>& maximised)
+{
+  const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(tiles_.size()))));
+  const int rows = (static_cast<int>(tiles_.size()) + columns - 1) / columns;
+  for (size_t i = 0; i < tiles_.size(); ++i)
+  {
+    MOSAIC_TILE& tile = *tiles_[i];
+    if (maximised.is_initialized())
+    {
+      // Everything else is hidden and drops to its smallest source
+      tile.x_ = 0;
+      tile.y_ = 0;
+      tile.width_ = (*maximised == i) ? width : 0;
+      tile.height_ = (*maximised == i) ? height : 0;
+    }
+    else
+    {
+      const int column = static_cast<int>(i) % columns;
+      const int row = static_cast<int>(i) / columns;
+      tile.x_ = (column * width) / columns;
+      tile.y_ = (row * height) / rows;
+      tile.width_ = (((column + 1) * width) / columns) - tile.x_;
+      tile.height_ = (((row + 1) * height) / rows) - tile.y_;
+    }
+    const size_t source = SelectSource(tile);
+    int memory_stream = -1;
+    if (tile.active_ == nullptr)
+    {
+      // Left blank until there is room for it
+      if (!Reserve(tile, source, memory_stream))
+      {
+        continue;
+      }
+      tile.active_ = OpenStream(tile, source, memory_stream, 0.0);
+      if (tile.active_ == nullptr)
+      {
+        return -1;
+      }
+      tile.start_ = std::chrono::steady_clock::now();
+      continue;
+    }
+    if (source == (tile.pending_ ? tile.pending_->source_ : tile.active_->source_))
+    {
+      continue;
+    }
+    // Either a new switch, or the tile changed size again before the last one finished
+    DestroyStream(tile.pending_);
+    // Without room for both streams during the switch the tile stays on the one it has
+    if ((source != tile.active_->source_) && Reserve(tile, source, memory_stream))
+    {
+      std::cout << "Switching tile " << i << " to " << tile.sources_[source].width_ << "x" << tile.sources_[source].height_ << std::endl;
+      tile.pending_ = OpenStream(tile, source, memory_stream, tile.GetPosition());
+      if (tile.pending_ == nullptr)
+      {
+        return -2;
+      }
+    }
+  }
+  return 0;
+}
+
+int MOSAIC::Update()
+{
+  std::vector<MppFrame> rendered;
+  std::vector<std::unique_ptr<MOSAIC_STREAM>> retired;
+  int result = 0;
+  for (size_t i = 0; i < tiles_.size(); ++i)
+  {
+    MOSAIC_TILE& tile = *tiles_[i];
+    if (tile.active_ == nullptr)
+    {
+      continue;
+    }
+    const double position = tile.GetPosition();
+    int ret = ReadPackets(tile, *tile.active_, position, 8);
+    if (ret < 0)
+    {
+      std::cout << "Failed to reset tile " << i << std::endl;
+      result = -1;
+      break;
+    }
+    else if (ret == 1)
+    {
+      // Loop, any switch in progress is restarted from the new position by the next layout
+      if (av_seek_frame(tile.active_->format_context_, tile.active_->stream_, tile.active_->start_pts_, AVSEEK_FLAG_BACKWARD) < 0)
+      {
+        std::cout << "Failed to seek tile " << i << std::endl;
+        result = -2;
+        break;
+      }
+      tile.active_->keyframe_ = false;
+      tile.start_ = std::chrono::steady_clock::now();
+      DestroyStream(tile.pending_);
+    }
+    // Only the most recent frame is worth drawing if the decoder has produced several
+    MppFrame latest = nullptr;
+    while (true)
+    {
+      MppFrame frame = nullptr;
+      ret = tile.active_->decoder_.GetFrame(frame);
+      if (ret < 0)
+      {
+        // Start again from the next IDR, like the player does, rather than ending playback
+        std::cout << "Failed to get frame for tile " << i << std::endl;
+        ++tile.resets_;
+        if (tile.active_->decoder_.Reset())
+        {
+          std::cout << "Failed to reset decoder" << std::endl;
+          result = -3;
+        }
+        tile.active_->keyframe_ = false;
+        break;
+      }
+      else if (ret == 1)
+      {
+        break;
+      }
+      else if (ret == 2)
+      {
+        DestroyImages(*tile.active_);
+        continue;
+      }
+      else if (ret == 3)
+      {
+        // Keep whatever good frame came before it and resync at the next IDR
+        ++tile.errors_;
+        tile.active_->keyframe_ = false;
+        continue;
+      }
+      else if (!IsRenderable(frame))
+      {
+        ++tile.errors_;
+        mpp_frame_deinit(&frame);
+        continue;
+      }
+      if (latest)
+      {
+        mpp_frame_deinit(&latest);
+      }
+      latest = frame;
+    }
+    if (latest)
+    {
+      rendered.push_back(latest);
+      if (tile.width_ && Render(tile, *tile.active_, latest))
+      {
+        result = -4;
+      }
+    }
+    if (result)
+    {
+      break;
+    }
+    if (tile.pending_ == nullptr)
+    {
+      continue;
+    }
+    // Catch up with the active stream a few packets at a time so the other tiles are not held up
+    if (ReadPackets(tile, *tile.pending_, position, 4))
+    {
+      std::cout << "Abandoning switch for tile " << i << std::endl;
+      DestroyStream(tile.pending_);
+      continue;
+    }
+    const double frame_time = 1.0 / tile.sources_[tile.pending_->source_].fps_;
+    while (tile.pending_)
+    {
+      MppFrame frame = nullptr;
+      ret = tile.pending_->decoder_.GetFrame(frame);
+      if (ret < 0)
+      {
+        std::cout << "Abandoning switch for tile " << i << std::endl;
+        DestroyStream(tile.pending_);
+        break;
+      }
+      else if (ret == 1)
+      {
+        break;
+      }
+      else if (ret == 2)
+      {
+        DestroyImages(*tile.pending_);
+        continue;
+      }
+      else if (ret == 3)
+      {
+        ++tile.errors_;
+        tile.pending_->keyframe_ = false;
+        continue;
+      }
+      else if (!IsRenderable(frame))
+      {
+        ++tile.errors_;
+        mpp_frame_deinit(&frame);
+        continue;
+      }
+      const double time = static_cast<double>(mpp_frame_get_pts(frame) - tile.pending_->start_pts_) * tile.pending_->time_base_;
+      if ((time + frame_time) < position)
+      {
+        // Between the IDR and where the active stream has got to
+        mpp_frame_deinit(&frame);
+        continue;
+      }
+      // Caught up, so this frame takes over from the active stream without a gap
+      rendered.push_back(frame);
+      if (tile.width_ && Render(tile, *tile.pending_, frame))
+      {
+        result = -5;
+        break;
+      }
+      retired.push_back(std::move(tile.active_));
+      tile.active_ = std::move(tile.pending_);
+      ++tile.switches_;
+    }
+    if (result)
+    {
+      break;
+    }
+  }
+  // Wait for the GPU to finish with the buffers before they go back to the decoders
+  if (rendered.size())
+  {
+    const EGLSyncKHR egl_sync = egl_create_sync_khr_(eglGetCurrentDisplay(), EGL_SYNC_FENCE_KHR, nullptr);
+    if (egl_sync == EGL_NO_SYNC_KHR)
+    {
+      std::cout << "Failed to create EGL sync object" << std::endl;
+    }
+    else
+    {
+      if (egl_client_wait_sync_khr_(eglGetCurrentDisplay(), egl_sync, EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, EGL_FOREVER_KHR) != EGL_CONDITION_SATISFIED_KHR)
+      {
+        std::cout << "Failed to sync EGL buffers" << std::endl;
+      }
+      if (egl_destroy_sync_khr_(eglGetCurrentDisplay(), egl_sync) == EGL_FALSE)
+      {
+        std::cout << "Failed to destroy EGL sync object" << std::endl;
+      }
+    }
+  }
+  for (MppFrame frame : rendered)
+  {
+    mpp_frame_deinit(&frame);
+  }
+  for (std::unique_ptr<MOSAIC_STREAM>& stream : retired)
+  {
+    DestroyStream(stream);
+  }
+  // The tile's frame buffer counts against whichever stream is drawing into it
+  for (const std::unique_ptr<MOSAIC_TILE>& tile : tiles_)
+  {
+    if (tile->active_)
+    {
+      ReportMemory(*tile->active_, tile->frame_buffer_.get());
+    }
+    if (tile->pending_)
+    {
+      ReportMemory(*tile->pending_, nullptr);
+    }
+  }
+  return result;
+}
+
+void MOSAIC::Draw(const GLuint program, const GLint sampler_location, const int height)
+{
+  GL_CHECK(glUseProgram(program));
+  GL_CHECK(glActiveTexture(GL_TEXTURE0));
+  GL_CHECK(glUniform1i(sampler_location, 0));
+  GL_CHECK(glBindVertexArray(vao_));
+  for (const std::unique_ptr<MOSAIC_TILE>& tile : tiles_)
+  {
+    if ((tile->frame_buffer_ == nullptr) || (tile->width_ == 0) || (tile->height_ == 0))
+    {
+      continue;
+    }
+    // GL puts the origin at the bottom left
+    GL_CHECK(glViewport(tile->x_, height - tile->y_ - tile->height_, tile->width_, tile->height_));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, tile->frame_buffer_->texture_));
+    GL_CHECK(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
+  }
+  GL_CHECK(glBindVertexArray(0));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+  GL_CHECK(glUseProgram(0));
+}
+
+boost::optional<size_t> MOSAIC::GetTileAt(const int x, const int y) const
+{
+  for (size_t i = 0; i < tiles_.size(); ++i)
+  {
+    const MOSAIC_TILE& tile = *tiles_[i];
+    if ((x >= tile.x_) && (x < (tile.x_ + tile.width_)) && (y >= tile.y_) && (y < (tile.y_ + tile.height_)))
+    {
+      return i;
+    }
+  }
+  return boost::none;
+}
+
+double MOSAIC::GetPixelRate(const MOSAIC_TILE& tile) const
+{
+  double pixel_rate = 0.0;
+  if (tile.active_)
+  {
+    pixel_rate += tile.sources_[tile.active_->source_].GetPixelRate();
+  }
+  if (tile.pending_)
+  {
+    pixel_rate += tile.sources_[tile.pending_->source_].GetPixelRate();
+  }
+  return pixel_rate;
+}
+
+double MOSAIC::GetSavedPixelRate(const MOSAIC_TILE& tile) const
+{
+  // Against always decoding the biggest source, this goes negative briefly while a switch is catching up
+  return (tile.sources_.back().GetPixelRate() - GetPixelRate(tile));
+}
+
+size_t MOSAIC::SelectSource(const MOSAIC_TILE& tile) const
+{
+  for (size_t i = 0; i < tile.sources_.size(); ++i)
+  {
+    if ((tile.sources_[i].width_ >= static_cast<uint32_t>(tile.width_)) && (tile.sources_[i].height_ >= static_cast<uint32_t>(tile.height_)))
+    {
+      return i;
+    }
+  }
+  return (tile.sources_.size() - 1);
+}
+
+bool MOSAIC::Reserve(MOSAIC_TILE& tile, const size_t source, int& memory_stream)
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (tile.refused_.is_initialized() && (*tile.refused_ == source) && ((now - tile.refused_time_) < MOSAIC_REFUSED_RETRY))
+  {
+    return false;
+  }
+  const MOSAIC_SOURCE& mosaic_source = tile.sources_[source];
+  memory_stream = memory_->Open(mosaic_source.path_, EstimateStreamMemory(mosaic_source.width_, mosaic_source.height_));
+  if (memory_stream < 0)
+  {
+    tile.refused_ = source;
+    tile.refused_time_ = now;
+    return false;
+  }
+  tile.refused_ = boost::none;
+  return true;
+}
+
+std::unique_ptr<MOSAIC_STREAM> MOSAIC::OpenStream(const MOSAIC_TILE& tile, const size_t source, const int memory_stream, const double position)
+{
+  std::unique_ptr<MOSAIC_STREAM> stream = std::make_unique<MOSAIC_STREAM>(source, memory_stream);
+  const std::string& path = tile.sources_[source].path_;
+  if (avformat_open_input(&stream->format_context_, path.c_str(), nullptr, nullptr) != 0)
+  {
+    std::cout << "Failed to open avformat file: " << path << std::endl;
+    DestroyStream(stream);
+    return nullptr;
+  }
+  if (avformat_find_stream_info(stream->format_context_, nullptr) < 0)
+  {
+    std::cout << "Failed to find stream info: " << path << std::endl;
+    DestroyStream(stream);
+    return nullptr;
+  }
+  const AVStream* av_stream = nullptr;
+  for (unsigned int i = 0; i < stream->format_context_->nb_streams; i++)
+  {
+    if ((stream->format_context_->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) && (stream->format_context_->streams[i]->codecpar->codec_id == AVCodecID::AV_CODEC_ID_H264))
+    {
+      stream->stream_ = i;
+      av_stream = stream->format_context_->streams[i];
+      break;
+    }
+  }
+  if (av_stream == nullptr)
+  {
+    std::cout << "Failed to find video stream: " << path << std::endl;
+    DestroyStream(stream);
+    return nullptr;
+  }
+  stream->time_base_ = av_q2d(av_stream->time_base);
+  stream->start_pts_ = (av_stream->start_time != AV_NOPTS_VALUE) ? av_stream->start_time : 0;
+  if (stream->decoder_.Init(av_stream->codecpar))
+  {
+    std::cout << "Failed to initialise decoder: " << path << std::endl;
+    DestroyStream(stream);
+    return nullptr;
+  }
+  // Land on the IDR at or before where the tile is up to
+  if ((position > 0.0) && (av_seek_frame(stream->format_context_, stream->stream_, stream->start_pts_ + static_cast<int64_t>(position / stream->time_base_), AVSEEK_FLAG_BACKWARD) < 0))
+  {
+    std::cout << "Failed to seek: " << path << std::endl;
+    DestroyStream(stream);
+    return nullptr;
+  }
+  return stream;
+}
+
+void MOSAIC::DestroyStream(std::unique_ptr<MOSAIC_STREAM>& stream)
+{
+  if (stream == nullptr)
+  {
+    return;
+  }
+  DestroyImages(*stream);
+  if (stream->packet_)
+  {
+    av_packet_free(&stream->packet_);
+  }
+  stream->decoder_.Destroy();
+  if (stream->format_context_)
+  {
+    avformat_close_input(&stream->format_context_);
+  }
+  memory_->Close(stream->memory_stream_);
+  stream.reset();
+}
+
+void MOSAIC::DestroyImages(MOSAIC_STREAM& stream)
+{
+  for (const std::pair<const MppBuffer, MOSAIC_IMAGE>& image : stream.images_)
+  {
+    if (egl_destroy_image_khr_(eglGetCurrentDisplay(), image.second.image_) != EGL_TRUE)
+    {
+      std::cout << "Failed to destroy EGL image" << std::endl;
+    }
+  }
+  stream.images_.clear();
+}
+
+int MOSAIC::ReadPackets(MOSAIC_TILE& tile, MOSAIC_STREAM& stream, const double position, const size_t max_packets)
+{
+  size_t packets = 0;
+  while (packets < max_packets)
+  {
+    if (stream.packet_)
+    {
+      const double time = static_cast<double>(stream.packet_->pts - stream.start_pts_) * stream.time_base_;
+      if (time > position)
+      {
+        return 0;
+      }
+      av_packet_free(&stream.packet_);
+    }
+    AVPacket* packet = av_packet_alloc();
+    const int ret = av_read_frame(stream.format_context_, packet);
+    if (ret == AVERROR_EOF)
+    {
+      av_packet_free(&packet);
+      return 1;
+    }
+    else if (ret)
+    {
+      // Carry on from whatever can be read next time round, resyncing at the next IDR
+      std::cout << "Failed to read frame: " << ret << std::endl;
+      av_packet_free(&packet);
+      ++tile.errors_;
+      stream.keyframe_ = false;
+      return 0;
+    }
+    if ((packet->stream_index != stream.stream_) || (!stream.keyframe_ && !(packet->flags & AV_PKT_FLAG_KEY)))
+    {
+      av_packet_free(&packet);
+      continue;
+    }
+    stream.keyframe_ = true;
+    // A corrupt packet drops the stream back to the next IDR rather than ending playback
+    const int sent = stream.decoder_.SendPacket(packet);
+    if (sent < 0)
+    {
+      ++tile.resets_;
+      if (stream.decoder_.Reset())
+      {
+        std::cout << "Failed to reset decoder" << std::endl;
+        av_packet_free(&packet);
+        return -2;
+      }
+    }
+    if (sent)
+    {
+      ++tile.errors_;
+      stream.keyframe_ = false;
+    }
+    stream.packet_ = packet;
+    ++packets;
+  }
+  return 0;
+}
+
+int MOSAIC::Render(MOSAIC_TILE& tile, MOSAIC_STREAM& stream, MppFrame frame)
+{
+  MppBuffer mpp_buffer = mpp_frame_get_buffer(frame);
+  const RK_U32 width = mpp_frame_get_width(frame);
+  const RK_U32 height = mpp_frame_get_height(frame);
+  const RK_U32 offset_x = mpp_frame_get_offset_x(frame);
+  const RK_U32 offset_y = mpp_frame_get_offset_y(frame);
+  const RK_U32 hor_stride = mpp_frame_get_hor_stride(frame);
+  const RK_U32 ver_stride = mpp_frame_get_ver_stride(frame);
+  std::map<MppBuffer, MOSAIC_IMAGE>::iterator image = stream.images_.find(mpp_buffer);
+  if ((image != stream.images_.end()) && ((image->second.width_ != width) || (image->second.height_ != height)))
+  {
+    egl_destroy_image_khr_(eglGetCurrentDisplay(), image->second.image_);
+    stream.images_.erase(image);
+    image = stream.images_.end();
+  }
+  if (image == stream.images_.end())
+  {
+    const MppFrameColorSpace colour_space = mpp_frame_get_colorspace(frame);
+    EGLint egl_colour_space = EGL_ITU_REC601_EXT;
+    if (colour_space == MPP_FRAME_SPC_BT709)
+    {
+      egl_colour_space = EGL_ITU_REC709_EXT;
+    }
+    else if ((colour_space == MPP_FRAME_SPC_BT2020_NCL) || (colour_space == MPP_FRAME_SPC_BT2020_CL))
+    {
+      egl_colour_space = EGL_ITU_REC2020_EXT;
+    }
+    const int fd = mpp_buffer_get_fd(mpp_buffer);
+    const EGL_IMAGE_PLANE planes[] =
+    {
+      { (offset_y * hor_stride) + offset_x, hor_stride },
+      { (hor_stride * ver_stride) + ((offset_y / 2) * hor_stride) + (offset_x & ~1), hor_stride }
+    };
+    EGLint atts[EGL_IMAGE_MAX_ATTRIBUTES];
+    GetEGLImageAttributes(atts, fd, width, height, DRM_FORMAT_NV12, planes, 2, egl_colour_space, (mpp_frame_get_color_range(frame) == MPP_FRAME_RANGE_JPEG) ? EGL_YUV_FULL_RANGE_EXT : EGL_YUV_NARROW_RANGE_EXT);
+    const EGLImageKHR egl_image = egl_create_image_khr_(eglGetCurrentDisplay(), EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, atts);
+    if (egl_image == EGL_NO_IMAGE_KHR)
+    {
+      std::cout << "Failed to create EGL image" << std::endl;
+      return -3;
+    }
+    image = stream.images_.insert(std::make_pair(mpp_buffer, MOSAIC_IMAGE(egl_image, width, height, mpp_buffer_get_size(mpp_buffer)))).first;
+  }
+  if (BindFrameBuffer(tile.frame_buffer_, width, height))
+  {
+    return -4;
+  }
+  GL_CHECK(glViewport(0, 0, tile.frame_buffer_->width_, tile.frame_buffer_->height_));
+  GL_CHECK(glUseProgram(oes_program_));
+  GL_CHECK(glActiveTexture(GL_TEXTURE0));
+  GL_CHECK(glUniform1i(oes_sampler_location_, 0));
+  GL_CHECK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, oes_texture_));
+  GL_CHECK(gl_egl_image_target_texture_2_does_(GL_TEXTURE_EXTERNAL_OES, image->second.image_));
+  GL_CHECK(glBindVertexArray(vao_));
+  GL_CHECK(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
+  GL_CHECK(glBindVertexArray(0));
+  GL_CHECK(glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0));
+  GL_CHECK(glUseProgram(0));
+  GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+  return 0;
+}
+
+void MOSAIC::ReportMemory(const MOSAIC_STREAM& stream, const FRAME_BUFFER* frame_buffer)
+{
+  size_t image_bytes = 0;
+  for (const std::pair<const MppBuffer, MOSAIC_IMAGE>& image : stream.images_)
+  {
+    image_bytes += image.second.size_;
+  }
+  memory_->Set(stream.memory_stream_, MEMORY_CATEGORY::MPP_BUFFERS, stream.decoder_.GetBufferBytes(), stream.decoder_.GetBufferCount());
+  memory_->Set(stream.memory_stream_, MEMORY_CATEGORY::EGL_IMAGES, image_bytes, stream.images_.size());
+  memory_->Set(stream.memory_stream_, MEMORY_CATEGORY::FRAME_BUFFERS, frame_buffer ? frame_buffer->GetBytes() : 0, frame_buffer ? 1 : 0);
+  memory_->Set(stream.memory_stream_, MEMORY_CATEGORY::PACKETS, stream.decoder_.GetPacketBytes() + (stream.packet_ ? stream.packet_->size : 0), stream.packet_ ? 1 : 0);
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <boost/optional.hpp>
+#include <chrono>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#include <map>
+#include <memory>
+#include <rockchip/rk_mpi.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "gl.hpp"
+#include "memory.hpp"
+#include "mpp_decoder.hpp"
+
+struct AVFormatContext;
+struct AVPacket;
+
+// How long a tile waits before asking for memory again after being refused
+const std::chrono::seconds MOSAIC_REFUSED_RETRY(5);
+
+// One of the alternative encodings of a camera, typically the main stream and one or more sub-streams
+struct MOSAIC_SOURCE
+{
+  MOSAIC_SOURCE(const std::string& path, const uint32_t width, const uint32_t height, const double fps)
+    : path_(path)
+    , width_(width)
+    , height_(height)
+    , fps_(fps)
+  {
+  }
+
+  double GetPixelRate() const { return (static_cast<double>(width_) * static_cast<double>(height_) * fps_); }
+
+  std::string path_;
+  uint32_t width_;
+  uint32_t height_;
+  double fps_;
+
+};
+
+struct MOSAIC_IMAGE
+{
+  MOSAIC_IMAGE(const EGLImageKHR image, const uint32_t width, const uint32_t height, const size_t size)
+    : image_(image)
+    , width_(width)
+    , height_(height)
+    , size_(size)
+  {
+  }
+
+  EGLImageKHR image_;
+  uint32_t width_;
+  uint32_t height_;
+  size_t size_; // Of the dma-buf the image keeps hold of
+
+};
+
+// A source that is open and being decoded
+struct MOSAIC_STREAM
+{
+  MOSAIC_STREAM(const size_t source, const int memory_stream)
+    : source_(source)
+    , memory_stream_(memory_stream)
+    , format_context_(nullptr)
+    , stream_(0)
+    , start_pts_(0)
+    , time_base_(0.0)
+    , packet_(nullptr)
+    , keyframe_(false)
+  {
+  }
+
+  size_t source_;
+  int memory_stream_;
+  AVFormatContext* format_context_;
+  int stream_;
+  int64_t start_pts_;
+  double time_base_;
+  MPP_DECODER decoder_;
+  AVPacket* packet_; // Already sent to the decoder, held until its time has passed before the next one is read
+  bool keyframe_; // Decoding only starts at an IDR after opening or seeking
+  std::map<MppBuffer, MOSAIC_IMAGE> images_;
+
+};
+
+struct MOSAIC_TILE
+{
+  MOSAIC_TILE()
+    : x_(0)
+    , y_(0)
+    , width_(0)
+    , height_(0)
+    , switches_(0)
+    , errors_(0)
+    , resets_(0)
+  {
+  }
+
+  double GetPosition() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count(); }
+
+  std::vector<MOSAIC_SOURCE> sources_; // Smallest first
+  std::unique_ptr<MOSAIC_STREAM> active_;
+  std::unique_ptr<MOSAIC_STREAM> pending_; // Decoding in the background until it catches up with active_ and replaces it
+  std::unique_ptr<FRAME_BUFFER> frame_buffer_;
+  std::chrono::steady_clock::time_point start_;
+  // On screen in frame buffer pixels from the top left, zero sized when hidden
+  int x_;
+  int y_;
+  int width_;
+  int height_;
+  uint64_t switches_;
+  uint64_t errors_; // Corrupt packets and damaged frames, each drops the stream back to the next IDR
+  uint64_t resets_;
+  boost::optional<size_t> refused_; // Source the memory limit last turned down
+  std::chrono::steady_clock::time_point refused_time_;
+
+};
+
+// A grid of cameras where each tile decodes the smallest of its sources that still covers the tile, switching between them at IDR frames
+class MOSAIC
+{
+ public:
+
+  MOSAIC();
+  ~MOSAIC();
+
+  int Init(const std::vector<std::vector<std::string>>& tiles, MEMORY& memory, const GLuint oes_program, const GLint oes_sampler_location, const GLuint vao);
+  void Destroy();
+
+  // Places the tiles over the frame buffer and starts any switches the new sizes call for
+  int Layout(const int width, const int height, const boost::optional<size_t>& maximised);
+  int Update();
+  void Draw(const GLuint program, const GLint sampler_location, const int height);
+
+  boost::optional<size_t> GetTileAt(const int x, const int y) const;
+  const std::vector<std::unique_ptr<MOSAIC_TILE>>& GetTiles() const { return tiles_; }
+  double GetPixelRate(const MOSAIC_TILE& tile) const;
+  double GetSavedPixelRate(const MOSAIC_TILE& tile) const;
+
+ private:
+
+  size_t SelectSource(const MOSAIC_TILE& tile) const;
+  // Returns false if the memory limit does not allow the source to be opened yet
+  bool Reserve(MOSAIC_TILE& tile, const size_t source, int& memory_stream);
+  std::unique_ptr<MOSAIC_STREAM> OpenStream(const MOSAIC_TILE& tile, const size_t source, const int memory_stream, const double position);
+  void DestroyStream(std::unique_ptr<MOSAIC_STREAM>& stream);
+  void DestroyImages(MOSAIC_STREAM& stream);
+  // Returns 1 at the end of the file, read and decode errors are counted on the tile and only a failed decoder reset is an error
+  int ReadPackets(MOSAIC_TILE& tile, MOSAIC_STREAM& stream, const double position, const size_t max_packets);
+  // Only fails on GL and EGL errors, frames must already be renderable
+  int Render(MOSAIC_TILE& tile, MOSAIC_STREAM& stream, MppFrame frame);
+  void ReportMemory(const MOSAIC_STREAM& stream, const FRAME_BUFFER* frame_buffer);
+
+  PFNEGLCREATEIMAGEKHRPROC egl_create_image_khr_;
+  PFNEGLDESTROYIMAGEKHRPROC egl_destroy_image_khr_;
+  PFNEGLCREATESYNCKHRPROC egl_create_sync_khr_;
+  PFNEGLDESTROYSYNCKHRPROC egl_destroy_sync_khr_;
+  PFNEGLCLIENTWAITSYNCKHRPROC egl_client_wait_sync_khr_;
+  PFNGLEGLIMAGETARGETTEXTURE2DOESPROC gl_egl_image_target_texture_2_does_;
+
+  GLuint oes_program_;
+  GLint oes_sampler_location_;
+  GLuint vao_;
+  GLuint oes_texture_;
+
+  MEMORY* memory_;
+
+  std::vector<std::unique_ptr<MOSAIC_TILE>> tiles_;
+
+};
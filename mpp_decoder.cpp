@@ -0,0 +1,233 @@
+#include "mpp_decoder.hpp"
+
+#include <iostream>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+MPP_DECODER::MPP_DECODER()
+  : context_(nullptr)
+  , api_(nullptr)
+  , packet_(nullptr)
+  , frame_group_(nullptr)
+  , frame_buffer_size_(0)
+  , packet_buffer_size_(0)
+  , decoded_(0)
+  , damaged_(0)
+  , resets_(0)
+{
+}
+
+MPP_DECODER::~MPP_DECODER()
+{
+  Destroy();
+}
+
+int MPP_DECODER::Init(const AVCodecParameters* parameters)
+{
+  Destroy();
+  if (parameters->codec_id != AV_CODEC_ID_H264) // Currently only support H264
+  {
+    std::cout << "Unsupported MPP codec" << std::endl;
+    return -1;
+  }
+  packet_buffer_size_ = 64;
+  packet_buffer_ = std::make_unique<char[]>(packet_buffer_size_);
+  if (mpp_packet_init(&packet_, packet_buffer_.get(), packet_buffer_size_))
+  {
+    std::cout << "Failed to initialise MPP packet" << std::endl;
+    Destroy();
+    return -2;
+  }
+  if (mpp_create(&context_, &api_) != MPP_OK)
+  {
+    std::cout << "Failed to create MPP context" << std::endl;
+    context_ = nullptr;
+    Destroy();
+    return -3;
+  }
+  RK_U32 need_split = 1;
+  if (api_->control(context_, MPP_DEC_SET_PARSER_SPLIT_MODE, &need_split) != MPP_OK)
+  {
+    std::cout << "Failed to set MPP split mode" << std::endl;
+    Destroy();
+    return -4;
+  }
+  if (mpp_init(context_, MPP_CTX_DEC, MPP_VIDEO_CodingAVC) != MPP_OK)
+  {
+    std::cout << "Failed to set MPP H264" << std::endl;
+    Destroy();
+    return -5;
+  }
+  // Find SPS/PPS if available and pass it to the decoder
+  ParseAVCCExtradata(parameters->extradata, parameters->extradata_size, spspps_);
+  if (spspps_.size())
+  {
+    std::cout << "Sending SPS and PPS" << std::endl;
+    if (SendNAL(spspps_.data(), spspps_.size(), 0))
+    {
+      std::cout << "Failed to send SPS+PPS frame" << std::endl;
+      Destroy();
+      return -6;
+    }
+  }
+  return 0;
+}
+
+void MPP_DECODER::Destroy()
+{
+  if (context_)
+  {
+    mpp_destroy(context_);
+    context_ = nullptr;
+  }
+  api_ = nullptr;
+  if (packet_)
+  {
+    mpp_packet_deinit(&packet_);
+    packet_ = nullptr;
+  }
+  if (frame_group_)
+  {
+    mpp_buffer_group_put(frame_group_);
+    frame_group_ = nullptr;
+  }
+  frame_buffer_size_ = 0;
+  packet_buffer_.reset();
+  packet_buffer_size_ = 0;
+  spspps_.clear();
+}
+
+int MPP_DECODER::Reset()
+{
+  if (context_ == nullptr)
+  {
+    return -1;
+  }
+  ++resets_;
+  if (api_->reset(context_) != MPP_OK)
+  {
+    std::cout << "Failed to reset MPP decoder" << std::endl;
+    return -2;
+  }
+  if (spspps_.size() && SendNAL(spspps_.data(), spspps_.size(), 0))
+  {
+    std::cout << "Failed to send SPS+PPS frame" << std::endl;
+    return -3;
+  }
+  return 0;
+}
+
+int MPP_DECODER::SendPacket(const AVPacket* packet)
+{
+  const int ret = SplitAVCCPacket(packet->data, packet->size, nals_);
+  for (const H264_NAL& nal : nals_)
+  {
+    // Build mpp frame
+    if (SendNAL(nal.data_, nal.size_, packet->pts))
+    {
+      std::cout << "Failed to send frame: " << nal.size_ << std::endl;
+      return -1;
+    }
+  }
+  return ret;
+}
+
+int MPP_DECODER::GetFrame(MppFrame& frame)
+{
+  frame = nullptr;
+  const int ret = api_->decode_get_frame(context_, &frame);
+  if (ret != MPP_OK)
+  {
+    std::cout << "Failed to get frame: " << ret << std::endl;
+    return -1;
+  }
+  if (frame == nullptr)
+  {
+    return 1;
+  }
+  if (mpp_frame_get_info_change(frame))
+  {
+    frame_buffer_size_ = mpp_frame_get_buf_size(frame);
+    mpp_frame_deinit(&frame);
+    std::cout << "Frame dimensions and format changed" << std::endl;
+    // Buffers from the previous group are freed once whoever is still holding them lets go
+    if (frame_group_ == nullptr)
+    {
+      if (mpp_buffer_group_get_internal(&frame_group_, MPP_BUFFER_TYPE_DRM))
+      {
+        std::cout << "Failed to set buffer group" << std::endl;
+        frame_group_ = nullptr;
+        return -2;
+      }
+    }
+    else
+    {
+      mpp_buffer_group_clear(frame_group_);
+    }
+    api_->control(context_, MPP_DEC_SET_EXT_BUF_GROUP, frame_group_);
+    api_->control(context_, MPP_DEC_SET_INFO_CHANGE_READY, nullptr);
+    return 2;
+  }
+  // Frames decoded from a damaged bitstream, or referencing one, are flagged rather than withheld by the decoder
+  if (mpp_frame_get_errinfo(frame) || mpp_frame_get_discard(frame))
+  {
+    mpp_frame_deinit(&frame);
+    ++damaged_;
+    return 3;
+  }
+  ++decoded_;
+  return 0;
+}
+
+size_t MPP_DECODER::GetBufferBytes() const
+{
+  if (frame_group_ == nullptr)
+  {
+    return 0;
+  }
+  return mpp_buffer_group_usage(frame_group_);
+}
+
+size_t MPP_DECODER::GetBufferCount() const
+{
+  if (frame_buffer_size_ == 0)
+  {
+    return 0;
+  }
+  return (GetBufferBytes() / frame_buffer_size_);
+}
+
+int MPP_DECODER::SendNAL(const uint8_t* ptr, const size_t size, const int64_t pts)
+{
+  const size_t nal_size = size + sizeof(H264_START_SEQUENCE);
+  if ((packet_buffer_ == nullptr) || (nal_size > packet_buffer_size_))
+  {
+    packet_buffer_ = std::make_unique<char[]>(nal_size);
+    packet_buffer_size_ = nal_size;
+    if (mpp_packet_deinit(&packet_) != MPP_OK)
+    {
+      std::cout << "Failed to deinit packet" << std::endl;
+      return -1;
+    }
+    if (mpp_packet_init(&packet_, packet_buffer_.get(), packet_buffer_size_) != MPP_OK)
+    {
+      std::cout << "Failed to init packet" << std::endl;
+      return -2;
+    }
+  }
+  // The packet wraps packet_buffer_, so writing the NAL there is all it takes
+  WriteAnnexBNAL(ptr, size, reinterpret_cast<uint8_t*>(packet_buffer_.get()));
+  mpp_packet_set_pos(packet_, packet_buffer_.get());
+  mpp_packet_set_length(packet_, nal_size);
+  mpp_packet_set_pts(packet_, pts);
+  const int ret = api_->decode_put_packet(context_, packet_);
+  if (ret != MPP_OK)
+  {
+    std::cout << "Failed to place packet: " << ret << std::endl;
+    return -3;
+  }
+  return 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+#include <rockchip/rk_mpi.h>
+#include <stdint.h>
+#include <vector>
+
+#include "bitstream.hpp"
+
+struct AVCodecParameters;
+struct AVPacket;
+
+// H264 decoding on the VPU through Rockchip MPP, frames come out in DRM buffers ready to import as EGL images
+class MPP_DECODER
+{
+ public:
+
+  MPP_DECODER();
+  ~MPP_DECODER();
+
+  int Init(const AVCodecParameters* parameters);
+  void Destroy();
+  // Drops everything in flight and sends the SPS/PPS again, decoding then needs to resume from an IDR
+  int Reset();
+
+  // Takes a length prefixed packet from the demuxer and hands each NAL to the decoder with a start code, returns 1 if the packet was malformed and only partly sent
+  int SendPacket(const AVPacket* packet);
+  // Returns 0 with a frame the caller must deinit, 1 when there is no frame, 2 when the decoder has reallocated its buffers, 3 when a damaged frame was dropped, or an error
+  int GetFrame(MppFrame& frame);
+
+  uint64_t GetDecoded() const { return decoded_; }
+  uint64_t GetDamaged() const { return damaged_; }
+  uint64_t GetResets() const { return resets_; }
+  size_t GetBufferBytes() const;
+  size_t GetBufferCount() const;
+  size_t GetPacketBytes() const { return packet_buffer_size_; }
+
+ private:
+
+  int SendNAL(const uint8_t* ptr, const size_t size, const int64_t pts);
+
+  MppCtx context_;
+  MppApi* api_;
+  MppPacket packet_;
+  MppBufferGroup frame_group_;
+  size_t frame_buffer_size_; // Of each buffer in the group
+  std::unique_ptr<char[]> packet_buffer_;
+  size_t packet_buffer_size_;
+  std::vector<uint8_t> spspps_;
+  std::vector<H264_NAL> nals_; // Kept to save allocating per packet
+  uint64_t decoded_;
+  uint64_t damaged_;
+  uint64_t resets_;
+
+};
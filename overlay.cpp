@@ -0,0 +1,148 @@
+#include "overlay.hpp"
+
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+OVERLAY::OVERLAY()
+  : window_(nullptr)
+  , refresh_(0)
+  , dirty_frames_(OVERLAY_DIRTY_FRAMES)
+  , rendered_(0)
+  , cached_(0)
+  , render_time_(0.0)
+{
+}
+
+OVERLAY::~OVERLAY()
+{
+  Destroy();
+}
+
+int OVERLAY::Init(GLFWwindow* window, const unsigned int refresh)
+{
+  Destroy();
+  window_ = window;
+  refresh_ = std::chrono::milliseconds(refresh);
+  dirty_frames_ = OVERLAY_DIRTY_FRAMES;
+  glfwSetWindowUserPointer(window_, this);
+  glfwSetCursorPosCallback(window_, CursorPosCallback);
+  glfwSetCursorEnterCallback(window_, CursorEnterCallback);
+  glfwSetMouseButtonCallback(window_, MouseButtonCallback);
+  glfwSetScrollCallback(window_, ScrollCallback);
+  glfwSetKeyCallback(window_, KeyCallback);
+  glfwSetCharCallback(window_, CharCallback);
+  glfwSetWindowFocusCallback(window_, WindowFocusCallback);
+  return 0;
+}
+
+void OVERLAY::Destroy()
+{
+  // ImGui still chains to the callbacks, they just have nothing to mark dirty
+  if (window_)
+  {
+    glfwSetWindowUserPointer(window_, nullptr);
+    window_ = nullptr;
+  }
+  frame_buffer_.reset();
+  rendered_ = 0;
+  cached_ = 0;
+  render_time_ = 0.0;
+}
+
+bool OVERLAY::Begin(const int width, const int height)
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (frame_buffer_ && (frame_buffer_->width_ == width) && (frame_buffer_->height_ == height) && (dirty_frames_ == 0) && (refresh_.count() != 0) && ((now - last_render_) < refresh_))
+  {
+    ++cached_;
+    return false;
+  }
+  if (BindFrameBuffer(frame_buffer_, width, height))
+  {
+    std::cout << "Failed to create overlay frame buffer" << std::endl;
+    return false;
+  }
+  render_start_ = now;
+  GL_CHECK(glViewport(0, 0, width, height));
+  GL_CHECK(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+  GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
+  return true;
+}
+
+void OVERLAY::End()
+{
+  GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+  if (dirty_frames_ > 0)
+  {
+    --dirty_frames_;
+  }
+  last_render_ = std::chrono::steady_clock::now();
+  const double elapsed = std::chrono::duration<double, std::milli>(last_render_ - render_start_).count();
+  render_time_ = (rendered_ == 0) ? elapsed : ((render_time_ * 0.9) + (elapsed * 0.1));
+  ++rendered_;
+}
+
+void OVERLAY::Draw(const GLuint program, const GLint sampler_location, const GLuint vao) const
+{
+  if (frame_buffer_ == nullptr)
+  {
+    return;
+  }
+  // ImGui blends into the transparent texture, which leaves the colour premultiplied by its alpha
+  GL_CHECK(glEnable(GL_BLEND));
+  GL_CHECK(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+  GL_CHECK(glUseProgram(program));
+  GL_CHECK(glActiveTexture(GL_TEXTURE0));
+  GL_CHECK(glUniform1i(sampler_location, 0));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, frame_buffer_->texture_));
+  GL_CHECK(glBindVertexArray(vao));
+  GL_CHECK(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
+  GL_CHECK(glBindVertexArray(0));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+  GL_CHECK(glUseProgram(0));
+  GL_CHECK(glDisable(GL_BLEND));
+}
+
+void OVERLAY::CursorPosCallback(GLFWwindow* window, double, double)
+{
+  Input(window);
+}
+
+void OVERLAY::CursorEnterCallback(GLFWwindow* window, int)
+{
+  Input(window);
+}
+
+void OVERLAY::MouseButtonCallback(GLFWwindow* window, int, int, int)
+{
+  Input(window);
+}
+
+void OVERLAY::ScrollCallback(GLFWwindow* window, double, double)
+{
+  Input(window);
+}
+
+void OVERLAY::KeyCallback(GLFWwindow* window, int, int, int, int)
+{
+  Input(window);
+}
+
+void OVERLAY::CharCallback(GLFWwindow* window, unsigned int)
+{
+  Input(window);
+}
+
+void OVERLAY::WindowFocusCallback(GLFWwindow* window, int)
+{
+  Input(window);
+}
+
+void OVERLAY::Input(GLFWwindow* window)
+{
+  OVERLAY* overlay = reinterpret_cast<OVERLAY*>(glfwGetWindowUserPointer(window));
+  if (overlay)
+  {
+    overlay->Invalidate();
+  }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <GLES3/gl3.h>
+#include <memory>
+#include <stdint.h>
+
+#include "gl.hpp"
+
+struct GLFWwindow;
+
+// ImGui settles hover and popup state over a couple of frames, so input keeps the overlay live for a few
+const int OVERLAY_DIRTY_FRAMES = 3;
+
+// Caches the ImGui overlay in a texture at window size, which is only rebuilt on input, a state change or when the refresh interval passes
+// The cached texture is blended over the video every frame, so a frame without changes costs one textured quad
+class OVERLAY
+{
+ public:
+
+  OVERLAY();
+  ~OVERLAY();
+
+  // Installs the input callbacks, which must happen before ImGui installs its own so that it chains to these
+  // A refresh of 0ms rebuilds the overlay every frame
+  int Init(GLFWwindow* window, const unsigned int refresh);
+  void Destroy();
+
+  void Invalidate() { dirty_frames_ = OVERLAY_DIRTY_FRAMES; }
+  // Returns true with the overlay frame buffer bound and cleared if it needs rebuilding, in which case End() must follow the ImGui render
+  bool Begin(const int width, const int height);
+  void End();
+  // Blends the cached overlay over whatever is in the bound frame buffer
+  void Draw(const GLuint program, const GLint sampler_location, const GLuint vao) const;
+
+  uint64_t GetRendered() const { return rendered_; }
+  uint64_t GetCached() const { return cached_; }
+  double GetRenderTime() const { return render_time_; } // Milliseconds
+  size_t GetBytes() const { return frame_buffer_ ? frame_buffer_->GetBytes() : 0; }
+
+ private:
+
+  static void CursorPosCallback(GLFWwindow* window, double x, double y);
+  static void CursorEnterCallback(GLFWwindow* window, int entered);
+  static void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+  static void ScrollCallback(GLFWwindow* window, double x, double y);
+  static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+  static void CharCallback(GLFWwindow* window, unsigned int c);
+  static void WindowFocusCallback(GLFWwindow* window, int focused);
+  static void Input(GLFWwindow* window);
+
+  GLFWwindow* window_;
+  std::chrono::milliseconds refresh_;
+  std::unique_ptr<FRAME_BUFFER> frame_buffer_;
+  int dirty_frames_;
+  std::chrono::steady_clock::time_point last_render_;
+  std::chrono::steady_clock::time_point render_start_;
+
+  uint64_t rendered_;
+  uint64_t cached_;
+  double render_time_;
+
+};
@@ -0,0 +1,440 @@
+#include "recorder.hpp"
+
+#include <chrono>
+#include <ctime>
+#include <iostream>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+// Decode order is what matters for cutting and pacing, pts is only used when the demuxer gives no dts
+static int64_t GetTimestamp(const AVPacket* packet)
+{
+  return ((packet->dts != AV_NOPTS_VALUE) ? packet->dts : packet->pts);
+}
+
+RECORDER::RECORDER()
+  : format_(RECORDER_FORMAT::MP4)
+  , pre_event_(0.0)
+  , budget_(0)
+  , segment_duration_(0.0)
+  , codec_parameters_(nullptr)
+  , time_base_(av_make_q(1, 1))
+  , pre_event_bytes_(0)
+  , recording_(false)
+  , keyframe_(false)
+  , queued_bytes_(0)
+  , running_(false)
+  , output_context_(nullptr)
+  , segment_start_(0)
+  , last_dts_(AV_NOPTS_VALUE)
+  , sequence_(0)
+  , written_(0)
+  , written_bytes_(0)
+  , segments_(0)
+  , dropped_(0)
+  , failed_(0)
+{
+}
+
+RECORDER::~RECORDER()
+{
+  Destroy();
+}
+
+int RECORDER::Init(const AVStream* stream, const RECORDER_FORMAT format, const double pre_event, const size_t budget, const double segment_duration)
+{
+  Destroy();
+  if ((budget == 0) || (segment_duration <= 0.0))
+  {
+    std::cout << "Invalid recorder settings" << std::endl;
+    return -1;
+  }
+  codec_parameters_ = avcodec_parameters_alloc();
+  if (codec_parameters_ == nullptr)
+  {
+    std::cout << "Failed to allocate recorder codec parameters" << std::endl;
+    return -2;
+  }
+  if (avcodec_parameters_copy(codec_parameters_, stream->codecpar) < 0)
+  {
+    std::cout << "Failed to copy recorder codec parameters" << std::endl;
+    Destroy();
+    return -3;
+  }
+  format_ = format;
+  pre_event_ = pre_event;
+  budget_ = budget;
+  segment_duration_ = segment_duration;
+  time_base_ = stream->time_base;
+  running_ = true;
+  thread_ = std::thread([this](){ Run(); });
+  return 0;
+}
+
+void RECORDER::Destroy()
+{
+  // Whatever has been queued is still written out before the writer finishes
+  if (thread_.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+    }
+    condition_.notify_all();
+    thread_.join();
+  }
+  for (AVPacket* packet : packets_)
+  {
+    av_packet_free(&packet);
+  }
+  packets_.clear();
+  queued_bytes_ = 0;
+  CloseSegment();
+  ClearPreEvent();
+  recording_ = false;
+  keyframe_ = false;
+  if (codec_parameters_)
+  {
+    avcodec_parameters_free(&codec_parameters_);
+    codec_parameters_ = nullptr;
+  }
+}
+
+void RECORDER::Push(const AVPacket* packet)
+{
+  if ((codec_parameters_ == nullptr) || (packet->size == 0))
+  {
+    return;
+  }
+  const bool key = (packet->flags & AV_PKT_FLAG_KEY);
+  if (recording_)
+  {
+    if (!keyframe_ && !key)
+    {
+      ++dropped_;
+      return;
+    }
+    // The packet shares the demuxer's buffer, only the reference is new
+    keyframe_ = Queue(av_packet_clone(packet));
+    return;
+  }
+  if (pre_event_ <= 0.0)
+  {
+    return;
+  }
+  if (key)
+  {
+    pre_event_gops_.push_back(RECORDER_GOP());
+  }
+  else if (pre_event_gops_.empty())
+  {
+    return;
+  }
+  AVPacket* reference = av_packet_clone(packet);
+  if (reference == nullptr)
+  {
+    std::cout << "Failed to reference recorder packet" << std::endl;
+    ClearPreEvent();
+    return;
+  }
+  pre_event_gops_.back().packets_.push_back(reference);
+  pre_event_gops_.back().size_ += reference->size;
+  pre_event_bytes_ += reference->size;
+  // Drop the oldest GOP once the ones after it cover the pre-event time on their own, or when over budget
+  while (pre_event_gops_.size() > 1)
+  {
+    const double duration = static_cast<double>(GetTimestamp(reference) - GetTimestamp(pre_event_gops_[1].packets_.front())) * av_q2d(time_base_);
+    if ((duration < pre_event_) && (pre_event_bytes_ <= budget_))
+    {
+      break;
+    }
+    for (AVPacket* gop_packet : pre_event_gops_.front().packets_)
+    {
+      av_packet_free(&gop_packet);
+    }
+    pre_event_bytes_ -= pre_event_gops_.front().size_;
+    pre_event_gops_.pop_front();
+  }
+  // A single GOP bigger than the budget can not be kept at all
+  if (pre_event_bytes_ > budget_)
+  {
+    ClearPreEvent();
+  }
+}
+
+void RECORDER::Start()
+{
+  if ((codec_parameters_ == nullptr) || recording_)
+  {
+    return;
+  }
+  std::cout << "Starting recording with " << GetPreEventDuration() << " seconds of pre-event" << std::endl;
+  keyframe_ = false;
+  for (RECORDER_GOP& gop : pre_event_gops_)
+  {
+    // Once a packet is dropped the rest of its GOP can not be decoded, so none of it is written
+    bool kept = true;
+    for (AVPacket* packet : gop.packets_)
+    {
+      if (kept)
+      {
+        kept = Queue(packet);
+      }
+      else
+      {
+        av_packet_free(&packet);
+        ++dropped_;
+      }
+    }
+    gop.packets_.clear();
+    keyframe_ = kept;
+  }
+  pre_event_gops_.clear();
+  pre_event_bytes_ = 0;
+  recording_ = true;
+}
+
+void RECORDER::Stop()
+{
+  if (!recording_)
+  {
+    return;
+  }
+  std::cout << "Stopping recording" << std::endl;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    packets_.push_back(nullptr);
+  }
+  condition_.notify_one();
+  recording_ = false;
+}
+
+double RECORDER::GetPreEventDuration() const
+{
+  if (pre_event_gops_.empty())
+  {
+    return 0.0;
+  }
+  return (static_cast<double>(GetTimestamp(pre_event_gops_.back().packets_.back()) - GetTimestamp(pre_event_gops_.front().packets_.front())) * av_q2d(time_base_));
+}
+
+size_t RECORDER::GetQueuedBytes()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queued_bytes_;
+}
+
+size_t RECORDER::GetQueuedPackets()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return packets_.size();
+}
+
+size_t RECORDER::GetPreEventPackets() const
+{
+  size_t packets = 0;
+  for (const RECORDER_GOP& gop : pre_event_gops_)
+  {
+    packets += gop.packets_.size();
+  }
+  return packets;
+}
+
+void RECORDER::ClearPreEvent()
+{
+  for (RECORDER_GOP& gop : pre_event_gops_)
+  {
+    for (AVPacket* packet : gop.packets_)
+    {
+      av_packet_free(&packet);
+    }
+  }
+  pre_event_gops_.clear();
+  pre_event_bytes_ = 0;
+}
+
+bool RECORDER::Queue(AVPacket* packet)
+{
+  if (packet == nullptr)
+  {
+    std::cout << "Failed to reference recorder packet" << std::endl;
+    ++dropped_;
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ((queued_bytes_ + packet->size) > (budget_ * 2))
+    {
+      // The writer has fallen too far behind, skip to the next GOP rather than write a broken one
+      av_packet_free(&packet);
+      ++dropped_;
+      return false;
+    }
+    queued_bytes_ += packet->size;
+    packets_.push_back(packet);
+  }
+  condition_.notify_one();
+  return true;
+}
+
+void RECORDER::Run()
+{
+  while (true)
+  {
+    AVPacket* packet = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this](){ return (!running_ || !packets_.empty()); });
+      if (packets_.empty())
+      {
+        break;
+      }
+      packet = packets_.front();
+      packets_.pop_front();
+      if (packet)
+      {
+        queued_bytes_ -= packet->size;
+      }
+    }
+    if (packet == nullptr)
+    {
+      CloseSegment();
+      continue;
+    }
+    if (Write(packet))
+    {
+      ++failed_;
+    }
+    av_packet_free(&packet);
+  }
+  CloseSegment();
+}
+
+int RECORDER::Write(AVPacket* packet)
+{
+  const int64_t dts = GetTimestamp(packet);
+  const bool key = (packet->flags & AV_PKT_FLAG_KEY);
+  if (output_context_)
+  {
+    // Cut at keyframes, either when the segment is long enough or when the source has looped back
+    if (key && ((dts < last_dts_) || ((static_cast<double>(dts - segment_start_) * av_q2d(time_base_)) >= segment_duration_)))
+    {
+      CloseSegment();
+    }
+    else if (dts < last_dts_)
+    {
+      ++dropped_;
+      return 0;
+    }
+  }
+  if (output_context_ == nullptr)
+  {
+    if (!key)
+    {
+      // Left over from a segment that failed, so wait for the next GOP
+      ++dropped_;
+      return 0;
+    }
+    segment_start_ = dts;
+    if (OpenSegment())
+    {
+      return -1;
+    }
+  }
+  last_dts_ = dts;
+  const int size = packet->size;
+  // Every segment starts from zero
+  if (packet->pts != AV_NOPTS_VALUE)
+  {
+    packet->pts -= segment_start_;
+  }
+  if (packet->dts != AV_NOPTS_VALUE)
+  {
+    packet->dts -= segment_start_;
+  }
+  packet->stream_index = 0;
+  packet->pos = -1;
+  av_packet_rescale_ts(packet, time_base_, output_context_->streams[0]->time_base);
+  if (av_write_frame(output_context_, packet) < 0)
+  {
+    std::cout << "Failed to write recording packet" << std::endl;
+    CloseSegment();
+    return -2;
+  }
+  ++written_;
+  written_bytes_ += size;
+  return 0;
+}
+
+int RECORDER::OpenSegment()
+{
+  const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+  std::tm tm;
+  localtime_r(&now, &tm);
+  char timestamp[32];
+  std::strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &tm);
+  const std::string path = std::string("recording_") + timestamp + "_" + std::to_string(sequence_++) + ((format_ == RECORDER_FORMAT::MP4) ? ".mp4" : ".mkv");
+  if (avformat_alloc_output_context2(&output_context_, nullptr, (format_ == RECORDER_FORMAT::MP4) ? "mp4" : "matroska", path.c_str()) < 0)
+  {
+    std::cout << "Failed to create recording: " << path << std::endl;
+    output_context_ = nullptr;
+    return -1;
+  }
+  AVStream* stream = avformat_new_stream(output_context_, nullptr);
+  if (stream == nullptr)
+  {
+    std::cout << "Failed to create recording stream: " << path << std::endl;
+    CloseSegment();
+    return -2;
+  }
+  if (avcodec_parameters_copy(stream->codecpar, codec_parameters_) < 0)
+  {
+    std::cout << "Failed to copy recording codec parameters: " << path << std::endl;
+    CloseSegment();
+    return -3;
+  }
+  stream->codecpar->codec_tag = 0;
+  stream->time_base = time_base_;
+  if (!(output_context_->oformat->flags & AVFMT_NOFILE) && (avio_open(&output_context_->pb, path.c_str(), AVIO_FLAG_WRITE) < 0))
+  {
+    std::cout << "Failed to open recording file: " << path << std::endl;
+    CloseSegment();
+    return -4;
+  }
+  if (avformat_write_header(output_context_, nullptr) < 0)
+  {
+    std::cout << "Failed to write recording header: " << path << std::endl;
+    CloseSegment();
+    return -5;
+  }
+  std::cout << "Recording to " << path << std::endl;
+  ++segments_;
+  return 0;
+}
+
+void RECORDER::CloseSegment()
+{
+  if (output_context_ == nullptr)
+  {
+    return;
+  }
+  if (output_context_->pb)
+  {
+    // Only segments that got as far as writing a packet have a trailer to write
+    if ((last_dts_ != AV_NOPTS_VALUE) && (av_write_trailer(output_context_) < 0))
+    {
+      std::cout << "Failed to write recording trailer" << std::endl;
+    }
+    if (!(output_context_->oformat->flags & AVFMT_NOFILE))
+    {
+      avio_closep(&output_context_->pb);
+    }
+  }
+  avformat_free_context(output_context_);
+  output_context_ = nullptr;
+  last_dts_ = AV_NOPTS_VALUE;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C"
+{
+#include <libavutil/rational.h>
+}
+
+struct AVCodecParameters;
+struct AVFormatContext;
+struct AVPacket;
+struct AVStream;
+
+enum class RECORDER_FORMAT
+{
+  MP4,
+  MKV
+};
+
+// Packets from one keyframe up to the next
+struct RECORDER_GOP
+{
+  RECORDER_GOP()
+    : size_(0)
+  {
+  }
+
+  std::vector<AVPacket*> packets_;
+  size_t size_;
+
+};
+
+// Remuxes the compressed packets of one stream into segment files on a writer thread, nothing is decoded or copied
+// While not recording the last few seconds are held in memory a GOP at a time, so a recording starts from before it was asked for
+class RECORDER
+{
+ public:
+
+  RECORDER();
+  ~RECORDER();
+
+  // The pre-event buffer holds whole GOPs covering pre_event seconds, within budget bytes. The writer may also fall behind by up to twice the budget before packets are dropped
+  int Init(const AVStream* stream, const RECORDER_FORMAT format, const double pre_event, const size_t budget, const double segment_duration);
+  void Destroy();
+
+  // Takes a reference to the packet data, called from the demux loop after the packet has gone to the decoder
+  void Push(const AVPacket* packet);
+  void Start();
+  void Stop();
+
+  bool IsRecording() const { return recording_; }
+  size_t GetPreEventBytes() const { return pre_event_bytes_; }
+  size_t GetPreEventPackets() const;
+  double GetPreEventDuration() const;
+  uint64_t GetWritten() const { return written_; }
+  uint64_t GetWrittenBytes() const { return written_bytes_; }
+  unsigned int GetSegments() const { return segments_; }
+  uint64_t GetDropped() const { return dropped_; }
+  unsigned int GetFailed() const { return failed_; }
+  size_t GetQueuedBytes();
+  size_t GetQueuedPackets();
+
+ private:
+
+  void ClearPreEvent();
+  // Takes ownership, returns false if the packet was dropped, after which nothing can be kept until the next keyframe
+  bool Queue(AVPacket* packet);
+  void Run();
+  int Write(AVPacket* packet);
+  int OpenSegment();
+  void CloseSegment();
+
+  RECORDER_FORMAT format_;
+  double pre_event_;
+  size_t budget_;
+  double segment_duration_;
+  AVCodecParameters* codec_parameters_;
+  AVRational time_base_;
+
+  // Demux loop only
+  std::deque<RECORDER_GOP> pre_event_gops_;
+  size_t pre_event_bytes_;
+  bool recording_;
+  bool keyframe_; // Waiting for a keyframe before anything more can be kept
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<AVPacket*> packets_; // nullptr closes the current segment
+  size_t queued_bytes_;
+  bool running_;
+
+  // Writer thread only
+  AVFormatContext* output_context_;
+  int64_t segment_start_;
+  int64_t last_dts_;
+  unsigned int sequence_;
+
+  std::atomic<uint64_t> written_;
+  std::atomic<uint64_t> written_bytes_;
+  std::atomic<unsigned int> segments_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<unsigned int> failed_;
+
+};
@@ -0,0 +1,71 @@
+#include "recovery.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+RECOVERY::RECOVERY()
+  : resyncing_(false)
+  , keyframe_(false)
+  , errors_(0)
+  , resets_(0)
+  , skipped_(0)
+  , recoveries_(0)
+  , last_recovery_time_(0.0)
+  , max_recovery_time_(0.0)
+{
+}
+
+RECOVERY::~RECOVERY()
+{
+}
+
+void RECOVERY::Error(const bool reset)
+{
+  ++errors_;
+  if (reset)
+  {
+    ++resets_;
+  }
+  // Recovery time is measured from the first error, further errors while resyncing just extend it
+  if (!resyncing_)
+  {
+    std::cout << "Resyncing at the next IDR" << std::endl;
+    resyncing_ = true;
+    error_time_ = std::chrono::steady_clock::now();
+  }
+  keyframe_ = false;
+}
+
+bool RECOVERY::Accept(const AVPacket* packet)
+{
+  if (!resyncing_)
+  {
+    return true;
+  }
+  if (!(packet->flags & AV_PKT_FLAG_KEY))
+  {
+    ++skipped_;
+    return false;
+  }
+  keyframe_ = true;
+  return true;
+}
+
+void RECOVERY::Frame()
+{
+  if (!resyncing_ || !keyframe_)
+  {
+    return;
+  }
+  resyncing_ = false;
+  keyframe_ = false;
+  ++recoveries_;
+  last_recovery_time_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - error_time_).count();
+  max_recovery_time_ = std::max(max_recovery_time_, last_recovery_time_);
+  std::cout << "Recovered in " << last_recovery_time_ << "ms" << std::endl;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+
+struct AVPacket;
+
+// Tracks resynchronisation after a corrupt packet or decode error, nothing more is sent to the decoder until the next IDR and recovery ends at the first good frame after it
+class RECOVERY
+{
+ public:
+
+  RECOVERY();
+  ~RECOVERY();
+
+  void Error(const bool reset);
+  // Whether the packet should go to the decoder
+  bool Accept(const AVPacket* packet);
+  void Frame();
+
+  bool IsResyncing() const { return resyncing_; }
+  uint64_t GetErrors() const { return errors_; }
+  uint64_t GetResets() const { return resets_; }
+  uint64_t GetSkipped() const { return skipped_; }
+  uint64_t GetRecoveries() const { return recoveries_; }
+  double GetLastRecoveryTime() const { return last_recovery_time_; } // Milliseconds
+  double GetMaxRecoveryTime() const { return max_recovery_time_; } // Milliseconds
+
+ private:
+
+  bool resyncing_;
+  bool keyframe_; // An IDR has been sent since the error
+  std::chrono::steady_clock::time_point error_time_;
+
+  uint64_t errors_;
+  uint64_t resets_;
+  uint64_t skipped_;
+  uint64_t recoveries_;
+  double last_recovery_time_;
+  double max_recovery_time_;
+
+};
@@ -0,0 +1,190 @@
+#include "rga_scaler.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <rga/rga.h>
+
+MPP_SCALER_ALLOCATOR::MPP_SCALER_ALLOCATOR()
+  : group_(nullptr)
+  , count_(0)
+{
+}
+
+MPP_SCALER_ALLOCATOR::~MPP_SCALER_ALLOCATOR()
+{
+  Destroy();
+}
+
+int MPP_SCALER_ALLOCATOR::Init()
+{
+  Destroy();
+  if (mpp_buffer_group_get_internal(&group_, MPP_BUFFER_TYPE_DRM))
+  {
+    std::cout << "Failed to create scaler buffer group" << std::endl;
+    group_ = nullptr;
+    return -1;
+  }
+  return 0;
+}
+
+void MPP_SCALER_ALLOCATOR::Destroy()
+{
+  if (group_)
+  {
+    mpp_buffer_group_put(group_);
+    group_ = nullptr;
+  }
+}
+
+int MPP_SCALER_ALLOCATOR::Allocate(const size_t size, SCALER_BUFFER& buffer)
+{
+  if (group_ == nullptr)
+  {
+    return -1;
+  }
+  MppBuffer mpp_buffer = nullptr;
+  if (mpp_buffer_get(group_, &mpp_buffer, size) != MPP_OK)
+  {
+    return -2;
+  }
+  buffer.handle_ = mpp_buffer;
+  buffer.fd_ = mpp_buffer_get_fd(mpp_buffer);
+  buffer.ptr_ = reinterpret_cast<uint8_t*>(mpp_buffer_get_ptr(mpp_buffer));
+  ++count_;
+  return 0;
+}
+
+void MPP_SCALER_ALLOCATOR::Free(SCALER_BUFFER& buffer)
+{
+  mpp_buffer_put(static_cast<MppBuffer>(buffer.handle_));
+  buffer.handle_ = nullptr;
+  --count_;
+}
+
+size_t MPP_SCALER_ALLOCATOR::GetBytes() const
+{
+  if (group_ == nullptr)
+  {
+    return 0;
+  }
+  return mpp_buffer_group_usage(group_);
+}
+
+RGA_SCALER::RGA_SCALER()
+  : unsupported_colour_(false)
+{
+}
+
+RGA_SCALER::~RGA_SCALER()
+{
+  Destroy();
+}
+
+void RGA_SCALER::Destroy()
+{
+  Reset();
+  for (const std::pair<const int, rga_buffer_handle_t>& handle : destination_handles_)
+  {
+    releasebuffer_handle(handle.second);
+  }
+  destination_handles_.clear();
+  unsupported_colour_ = false;
+  SCALER::Destroy();
+}
+
+void RGA_SCALER::Reset()
+{
+  for (const std::pair<const int, rga_buffer_handle_t>& handle : source_handles_)
+  {
+    releasebuffer_handle(handle.second);
+  }
+  source_handles_.clear();
+}
+
+int RGA_SCALER::Scale(const SCALER_FRAME& source, SCALER_BUFFER*& destination)
+{
+  if ((source.fd_ == -1) || buffers_.empty() || (buffers_.front()->fd_ == -1))
+  {
+    std::cout << "RGA scaler requires dma-buf frames" << std::endl;
+    return -1;
+  }
+  // im2d has no full range BT.709 or any BT.2020 conversion, so those are left to the shader rather than converted wrongly
+  if ((format_ == SCALER_FORMAT::RGBA) && ((source.colour_space_ == YUV_COLOUR_SPACE::BT2020) || ((source.colour_space_ == YUV_COLOUR_SPACE::BT709) && source.full_range_)))
+  {
+    if (!unsupported_colour_)
+    {
+      std::cout << "RGA can not convert this colour space to RGBA, leaving it unscaled" << std::endl;
+      unsupported_colour_ = true;
+    }
+    return -2;
+  }
+  SCALER_BUFFER* buffer = Acquire();
+  if (buffer == nullptr)
+  {
+    std::cout << "No free scaler buffers" << std::endl;
+    return -3;
+  }
+  // Importing is comparatively expensive, so keep the handle for each buffer in the decoder pool
+  const rga_buffer_handle_t source_handle = GetHandle(source_handles_, source.fd_, source.size_);
+  const rga_buffer_handle_t destination_handle = GetHandle(destination_handles_, buffer->fd_, buffer->size_);
+  if ((source_handle == 0) || (destination_handle == 0))
+  {
+    std::cout << "Failed to import RGA buffers" << std::endl;
+    Release(buffer);
+    return -4;
+  }
+  const int destination_format = (format_ == SCALER_FORMAT::NV12) ? RK_FORMAT_YCbCr_420_SP : RK_FORMAT_RGBA_8888;
+  rga_buffer_t src = wrapbuffer_handle(source_handle, source.width_, source.height_, RK_FORMAT_YCbCr_420_SP, source.hor_stride_, source.ver_stride_);
+  rga_buffer_t dst = wrapbuffer_handle(destination_handle, width_, height_, destination_format, buffer->hor_stride_, buffer->ver_stride_);
+  int colour_mode = IM_YUV_TO_RGB_BT601_LIMIT;
+  if (source.colour_space_ == YUV_COLOUR_SPACE::BT709)
+  {
+    colour_mode = IM_YUV_TO_RGB_BT709_LIMIT;
+  }
+  else if (source.full_range_)
+  {
+    colour_mode = IM_YUV_TO_RGB_BT601_FULL;
+  }
+  IM_STATUS status = IM_STATUS_FAILED;
+  if (source.crop_x_ || source.crop_y_)
+  {
+    const im_rect source_rect = { static_cast<int>(source.crop_x_), static_cast<int>(source.crop_y_), static_cast<int>(source.width_), static_cast<int>(source.height_) };
+    const im_rect destination_rect = { 0, 0, static_cast<int>(width_), static_cast<int>(height_) };
+    rga_buffer_t pat;
+    std::memset(&pat, 0, sizeof(pat));
+    const im_rect pattern_rect = { 0, 0, 0, 0 };
+    status = improcess(src, dst, pat, source_rect, destination_rect, pattern_rect, ((format_ == SCALER_FORMAT::RGBA) ? colour_mode : 0) | IM_SYNC);
+  }
+  else if (format_ == SCALER_FORMAT::NV12)
+  {
+    status = imresize(src, dst);
+  }
+  else
+  {
+    status = imcvtcolor(src, dst, RK_FORMAT_YCbCr_420_SP, destination_format, colour_mode);
+  }
+  if ((status != IM_STATUS_SUCCESS) && (status != IM_STATUS_NOERROR))
+  {
+    std::cout << "Failed to scale frame: " << imStrError(status) << std::endl;
+    Release(buffer);
+    return -5;
+  }
+  destination = buffer;
+  return 0;
+}
+
+rga_buffer_handle_t RGA_SCALER::GetHandle(std::map<int, rga_buffer_handle_t>& handles, const int fd, const size_t size)
+{
+  std::map<int, rga_buffer_handle_t>::const_iterator handle = handles.find(fd);
+  if (handle != handles.cend())
+  {
+    return handle->second;
+  }
+  const rga_buffer_handle_t new_handle = importbuffer_fd(fd, static_cast<int>(size));
+  if (new_handle == 0)
+  {
+    return 0;
+  }
+  handles.insert(std::make_pair(fd, new_handle));
+  return new_handle;
+}
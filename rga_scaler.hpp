@@ -0,0 +1,55 @@
+#pragma once
+
+#include <map>
+#include <rga/im2d.hpp>
+#include <rockchip/mpp_buffer.h>
+#include <stdint.h>
+
+#include "scaler.hpp"
+
+// Scaler output buffers from their own DRM buffer group, so they can be imported just like decoded frames. handle_ is the MppBuffer
+class MPP_SCALER_ALLOCATOR : public SCALER_ALLOCATOR
+{
+ public:
+
+  MPP_SCALER_ALLOCATOR();
+  ~MPP_SCALER_ALLOCATOR() override;
+
+  int Init();
+  void Destroy();
+
+  int Allocate(const size_t size, SCALER_BUFFER& buffer) override;
+  void Free(SCALER_BUFFER& buffer) override;
+
+  size_t GetBytes() const;
+  size_t GetCount() const { return count_; }
+
+ private:
+
+  MppBufferGroup group_;
+  size_t count_;
+
+};
+
+// Uses the RGA 2D engine directly on the dma-bufs. RGBA output fails for full range BT.709 and for BT.2020, which im2d can not convert
+class RGA_SCALER : public SCALER
+{
+ public:
+
+  RGA_SCALER();
+  ~RGA_SCALER() override;
+
+  void Destroy() override;
+  void Reset() override;
+
+  int Scale(const SCALER_FRAME& source, SCALER_BUFFER*& destination) override;
+
+ private:
+
+  rga_buffer_handle_t GetHandle(std::map<int, rga_buffer_handle_t>& handles, const int fd, const size_t size);
+
+  std::map<int, rga_buffer_handle_t> source_handles_;
+  std::map<int, rga_buffer_handle_t> destination_handles_;
+  bool unsupported_colour_; // Only said once, every frame of the stream will be the same
+
+};
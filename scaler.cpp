@@ -0,0 +1,189 @@
+#include "scaler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+extern "C"
+{
+#include <libswscale/swscale.h>
+}
+
+static int GetSwsColourSpace(const YUV_COLOUR_SPACE colour_space)
+{
+  switch (colour_space)
+  {
+    case YUV_COLOUR_SPACE::BT709:
+    {
+      return SWS_CS_ITU709;
+    }
+    case YUV_COLOUR_SPACE::BT2020:
+    {
+      return SWS_CS_BT2020;
+    }
+    case YUV_COLOUR_SPACE::BT601:
+    {
+      return SWS_CS_ITU601;
+    }
+  }
+  return SWS_CS_ITU601;
+}
+
+SCALER::SCALER()
+  : width_(0)
+  , height_(0)
+  , format_(SCALER_FORMAT::NV12)
+  , allocator_(nullptr)
+{
+}
+
+SCALER::~SCALER()
+{
+  Destroy();
+}
+
+int SCALER::Init(const uint32_t width, const uint32_t height, const SCALER_FORMAT format, const size_t buffers, SCALER_ALLOCATOR* allocator)
+{
+  Destroy();
+  if ((width == 0) || (height == 0) || (width % 2) || (height % 2) || (buffers == 0))
+  {
+    std::cout << "Invalid scaler parameters " << width << "x" << height << std::endl;
+    return -1;
+  }
+  width_ = width;
+  height_ = height;
+  format_ = format;
+  allocator_ = allocator;
+  // RGA wants 16 pixel aligned strides
+  const uint32_t hor_stride = (width + 15) & ~15;
+  const uint32_t ver_stride = (format == SCALER_FORMAT::NV12) ? ((height + 15) & ~15) : height;
+  const size_t size = (format == SCALER_FORMAT::NV12) ? ((hor_stride * ver_stride * 3) / 2) : (hor_stride * ver_stride * 4);
+  for (size_t i = 0; i < buffers; ++i)
+  {
+    std::unique_ptr<SCALER_BUFFER> buffer = std::make_unique<SCALER_BUFFER>();
+    if (allocator_)
+    {
+      if (allocator_->Allocate(size, *buffer))
+      {
+        std::cout << "Failed to allocate scaler buffer" << std::endl;
+        Destroy();
+        return -2;
+      }
+    }
+    else
+    {
+      buffer->memory_ = std::make_unique<uint8_t[]>(size);
+      buffer->ptr_ = buffer->memory_.get();
+    }
+    buffer->size_ = size;
+    buffer->hor_stride_ = hor_stride;
+    buffer->ver_stride_ = ver_stride;
+    buffers_.push_back(std::move(buffer));
+  }
+  return 0;
+}
+
+void SCALER::Destroy()
+{
+  for (std::unique_ptr<SCALER_BUFFER>& buffer : buffers_)
+  {
+    if (allocator_ && buffer->handle_)
+    {
+      allocator_->Free(*buffer);
+    }
+  }
+  buffers_.clear();
+  allocator_ = nullptr;
+  width_ = 0;
+  height_ = 0;
+}
+
+void SCALER::Reset()
+{
+}
+
+void SCALER::Release(SCALER_BUFFER* buffer)
+{
+  buffer->in_use_ = false;
+}
+
+SCALER_BUFFER* SCALER::Acquire()
+{
+  std::vector<std::unique_ptr<SCALER_BUFFER>>::iterator buffer = std::find_if(buffers_.begin(), buffers_.end(), [](const std::unique_ptr<SCALER_BUFFER>& buffer){ return !buffer->in_use_; });
+  if (buffer == buffers_.end())
+  {
+    return nullptr;
+  }
+  (*buffer)->in_use_ = true;
+  return buffer->get();
+}
+
+SWS_SCALER::SWS_SCALER()
+  : sws_context_(nullptr)
+{
+}
+
+SWS_SCALER::~SWS_SCALER()
+{
+  Destroy();
+}
+
+void SWS_SCALER::Destroy()
+{
+  if (sws_context_)
+  {
+    sws_freeContext(sws_context_);
+    sws_context_ = nullptr;
+  }
+  SCALER::Destroy();
+}
+
+int SWS_SCALER::Scale(const SCALER_FRAME& source, SCALER_BUFFER*& destination)
+{
+  if (source.ptr_ == nullptr)
+  {
+    std::cout << "Software scaler requires CPU accessible frames" << std::endl;
+    return -1;
+  }
+  SCALER_BUFFER* buffer = Acquire();
+  if (buffer == nullptr)
+  {
+    std::cout << "No free scaler buffers" << std::endl;
+    return -2;
+  }
+  const AVPixelFormat destination_format = (format_ == SCALER_FORMAT::NV12) ? AV_PIX_FMT_NV12 : AV_PIX_FMT_RGBA;
+  sws_context_ = sws_getCachedContext(sws_context_, source.width_, source.height_, AV_PIX_FMT_NV12, width_, height_, destination_format, SWS_BILINEAR, nullptr, nullptr, nullptr);
+  if (sws_context_ == nullptr)
+  {
+    std::cout << "Failed to create software scaler" << std::endl;
+    Release(buffer);
+    return -3;
+  }
+  // Match the RGA conversion so the two can be compared
+  const int* coefficients = sws_getCoefficients(GetSwsColourSpace(source.colour_space_));
+  sws_setColorspaceDetails(sws_context_, coefficients, source.full_range_ ? 1 : 0, coefficients, 1, 0, 1 << 16, 1 << 16);
+  const uint8_t* const source_planes[] =
+  {
+    source.ptr_ + (source.crop_y_ * source.hor_stride_) + source.crop_x_,
+    source.ptr_ + (source.hor_stride_ * source.ver_stride_) + ((source.crop_y_ / 2) * source.hor_stride_) + (source.crop_x_ & ~1)
+  };
+  const int source_strides[] = { static_cast<int>(source.hor_stride_), static_cast<int>(source.hor_stride_) };
+  uint8_t* const destination_planes[] =
+  {
+    buffer->ptr_,
+    (format_ == SCALER_FORMAT::NV12) ? (buffer->ptr_ + (buffer->hor_stride_ * buffer->ver_stride_)) : nullptr
+  };
+  const int destination_strides[] =
+  {
+    static_cast<int>((format_ == SCALER_FORMAT::NV12) ? buffer->hor_stride_ : (buffer->hor_stride_ * 4)),
+    static_cast<int>((format_ == SCALER_FORMAT::NV12) ? buffer->hor_stride_ : 0)
+  };
+  if (sws_scale(sws_context_, source_planes, source_strides, 0, source.height_, destination_planes, destination_strides) != static_cast<int>(height_))
+  {
+    std::cout << "Failed to scale frame" << std::endl;
+    Release(buffer);
+    return -4;
+  }
+  destination = buffer;
+  return 0;
+}
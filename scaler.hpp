@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "colour.hpp"
+
+struct SwsContext;
+
+enum class SCALER_FORMAT
+{
+  NV12,
+  RGBA
+};
+
+// An NV12 source frame, fd is -1 when the frame is only CPU accessible
+struct SCALER_FRAME
+{
+  int fd_;
+  uint8_t* ptr_;
+  size_t size_;
+  uint32_t width_;
+  uint32_t height_;
+  uint32_t hor_stride_;
+  uint32_t ver_stride_;
+  uint32_t crop_x_;
+  uint32_t crop_y_;
+  YUV_COLOUR_SPACE colour_space_;
+  bool full_range_;
+
+};
+
+struct SCALER_BUFFER
+{
+  SCALER_BUFFER()
+    : handle_(nullptr)
+    , fd_(-1)
+    , ptr_(nullptr)
+    , size_(0)
+    , hor_stride_(0)
+    , ver_stride_(0)
+    , in_use_(false)
+  {
+  }
+
+  void* handle_; // Whatever the allocator knows the buffer by, nullptr when the pool has no allocator and is backed by memory_ instead
+  std::unique_ptr<uint8_t[]> memory_;
+  int fd_;
+  uint8_t* ptr_;
+  size_t size_;
+  uint32_t hor_stride_; // Pixels
+  uint32_t ver_stride_;
+  bool in_use_;
+
+};
+
+// Supplies the pool's output buffers, so scaling can go straight into dma-bufs the GPU imports. It fills in handle_, fd_ and ptr_
+class SCALER_ALLOCATOR
+{
+ public:
+
+  virtual ~SCALER_ALLOCATOR() {}
+
+  virtual int Allocate(const size_t size, SCALER_BUFFER& buffer) = 0;
+  virtual void Free(SCALER_BUFFER& buffer) = 0;
+
+};
+
+// Post decode scaling and colour conversion into a pool of output buffers
+class SCALER
+{
+ public:
+
+  SCALER();
+  virtual ~SCALER();
+
+  // Without an allocator the buffers are ordinary memory, which only the software scaler can use
+  int Init(const uint32_t width, const uint32_t height, const SCALER_FORMAT format, const size_t buffers, SCALER_ALLOCATOR* allocator);
+  virtual void Destroy();
+  // Forget anything cached about source buffers, for when the decoder reallocates them
+  virtual void Reset();
+
+  virtual int Scale(const SCALER_FRAME& source, SCALER_BUFFER*& destination) = 0;
+  void Release(SCALER_BUFFER* buffer);
+
+  uint32_t GetWidth() const { return width_; }
+  uint32_t GetHeight() const { return height_; }
+  SCALER_FORMAT GetFormat() const { return format_; }
+
+ protected:
+
+  SCALER_BUFFER* Acquire();
+
+  uint32_t width_;
+  uint32_t height_;
+  SCALER_FORMAT format_;
+  SCALER_ALLOCATOR* allocator_;
+  std::vector<std::unique_ptr<SCALER_BUFFER>> buffers_;
+
+};
+
+// CPU implementation of the same interface with libswscale, for comparison and for machines without RGA
+class SWS_SCALER : public SCALER
+{
+ public:
+
+  SWS_SCALER();
+  ~SWS_SCALER() override;
+
+  void Destroy() override;
+
+  int Scale(const SCALER_FRAME& source, SCALER_BUFFER*& destination) override;
+
+ private:
+
+  SwsContext* sws_context_;
+
+};
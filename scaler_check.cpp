@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdint.h>
+#include <vector>
+
+#include "colour.hpp"
+#include "scaler.hpp"
+
+// Scales known NV12 frames through SWS_SCALER and compares the output against references, so the software path can be checked off target
+
+const uint32_t CHECK_WIDTH = 64;
+const uint32_t CHECK_HEIGHT = 48;
+const uint32_t CHECK_HOR_STRIDE = 80;
+const uint32_t CHECK_VER_STRIDE = 64;
+const uint32_t CHECK_CROP_X = 8;
+const uint32_t CHECK_CROP_Y = 4;
+const uint8_t CHECK_PADDING = 255; // Outside the crop, so any of it in the output means the crop was ignored
+
+// Luma is a horizontal ramp when ramp is set, otherwise flat, chroma is always flat so chroma interpolation can not affect the result
+static std::vector<uint8_t> MakeFrame(const bool ramp, const uint8_t y, const uint8_t u, const uint8_t v, const YUV_COLOUR_SPACE colour_space, SCALER_FRAME& frame)
+{
+  std::vector<uint8_t> data((CHECK_HOR_STRIDE * CHECK_VER_STRIDE * 3) / 2, CHECK_PADDING);
+  for (uint32_t row = 0; row < CHECK_HEIGHT; ++row)
+  {
+    for (uint32_t column = 0; column < CHECK_WIDTH; ++column)
+    {
+      data[((CHECK_CROP_Y + row) * CHECK_HOR_STRIDE) + CHECK_CROP_X + column] = ramp ? static_cast<uint8_t>(16 + ((column * 219) / (CHECK_WIDTH - 1))) : y;
+    }
+  }
+  for (uint32_t row = 0; row < (CHECK_HEIGHT / 2); ++row)
+  {
+    for (uint32_t column = 0; column < (CHECK_WIDTH / 2); ++column)
+    {
+      uint8_t* chroma = data.data() + (CHECK_HOR_STRIDE * CHECK_VER_STRIDE) + (((CHECK_CROP_Y / 2) + row) * CHECK_HOR_STRIDE) + CHECK_CROP_X + (column * 2);
+      chroma[0] = u;
+      chroma[1] = v;
+    }
+  }
+  frame.fd_ = -1;
+  frame.ptr_ = data.data();
+  frame.size_ = data.size();
+  frame.width_ = CHECK_WIDTH;
+  frame.height_ = CHECK_HEIGHT;
+  frame.hor_stride_ = CHECK_HOR_STRIDE;
+  frame.ver_stride_ = CHECK_VER_STRIDE;
+  frame.crop_x_ = CHECK_CROP_X;
+  frame.crop_y_ = CHECK_CROP_Y;
+  frame.colour_space_ = colour_space;
+  frame.full_range_ = false;
+  return data;
+}
+
+// A flat frame halved in size must come out exactly as flat, in both planes
+static int CheckNV12()
+{
+  const uint8_t y = 100;
+  const uint8_t u = 90;
+  const uint8_t v = 160;
+  SCALER_FRAME frame;
+  const std::vector<uint8_t> data = MakeFrame(false, y, u, v, YUV_COLOUR_SPACE::BT709, frame);
+  SWS_SCALER scaler;
+  if (scaler.Init(CHECK_WIDTH / 2, CHECK_HEIGHT / 2, SCALER_FORMAT::NV12, 1, nullptr))
+  {
+    std::cout << "Failed to initialise NV12 scaler" << std::endl;
+    return -1;
+  }
+  SCALER_BUFFER* buffer = nullptr;
+  if (scaler.Scale(frame, buffer))
+  {
+    std::cout << "Failed to scale NV12 frame" << std::endl;
+    return -2;
+  }
+  int max_error = 0;
+  for (uint32_t row = 0; row < scaler.GetHeight(); ++row)
+  {
+    for (uint32_t column = 0; column < scaler.GetWidth(); ++column)
+    {
+      max_error = std::max(max_error, std::abs(static_cast<int>(buffer->ptr_[(row * buffer->hor_stride_) + column]) - y));
+    }
+  }
+  for (uint32_t row = 0; row < (scaler.GetHeight() / 2); ++row)
+  {
+    for (uint32_t column = 0; column < (scaler.GetWidth() / 2); ++column)
+    {
+      const uint8_t* chroma = buffer->ptr_ + (buffer->hor_stride_ * buffer->ver_stride_) + (row * buffer->hor_stride_) + (column * 2);
+      max_error = std::max(max_error, std::abs(static_cast<int>(chroma[0]) - u));
+      max_error = std::max(max_error, std::abs(static_cast<int>(chroma[1]) - v));
+    }
+  }
+  scaler.Release(buffer);
+  std::cout << "NV12 max error: " << max_error << std::endl;
+  if (max_error > 1)
+  {
+    return -3;
+  }
+  return 0;
+}
+
+// Converting at the same size must match the CPU reference conversion the shader is also checked against
+static int CheckRGBA(const YUV_COLOUR_SPACE colour_space)
+{
+  const uint8_t u = 110;
+  const uint8_t v = 150;
+  SCALER_FRAME frame;
+  const std::vector<uint8_t> data = MakeFrame(true, 0, u, v, colour_space, frame);
+  SWS_SCALER scaler;
+  if (scaler.Init(CHECK_WIDTH, CHECK_HEIGHT, SCALER_FORMAT::RGBA, 1, nullptr))
+  {
+    std::cout << "Failed to initialise RGBA scaler" << std::endl;
+    return -1;
+  }
+  SCALER_BUFFER* buffer = nullptr;
+  if (scaler.Scale(frame, buffer))
+  {
+    std::cout << "Failed to scale RGBA frame" << std::endl;
+    return -2;
+  }
+  const YUV_MATRIX yuv_matrix = GetYUVMatrix(frame.colour_space_, frame.full_range_);
+  int max_error = 0;
+  for (uint32_t row = 0; row < CHECK_HEIGHT; ++row)
+  {
+    for (uint32_t column = 0; column < CHECK_WIDTH; ++column)
+    {
+      uint8_t rgb[3];
+      YUVToRGB(yuv_matrix, data[((CHECK_CROP_Y + row) * CHECK_HOR_STRIDE) + CHECK_CROP_X + column], u, v, rgb);
+      const uint8_t* pixel = buffer->ptr_ + (row * buffer->hor_stride_ * 4) + (column * 4);
+      for (int i = 0; i < 3; ++i)
+      {
+        max_error = std::max(max_error, std::abs(static_cast<int>(pixel[i]) - static_cast<int>(rgb[i])));
+      }
+    }
+  }
+  scaler.Release(buffer);
+  std::cout << "RGBA max error: " << max_error << std::endl;
+  // libswscale rounds its coefficients to fixed point
+  if (max_error > 4)
+  {
+    return -3;
+  }
+  return 0;
+}
+
+int main()
+{
+  if (CheckNV12())
+  {
+    std::cout << "NV12 scaling check failed" << std::endl;
+    return -1;
+  }
+  if (CheckRGBA(YUV_COLOUR_SPACE::BT709))
+  {
+    std::cout << "BT.709 RGBA conversion check failed" << std::endl;
+    return -2;
+  }
+  if (CheckRGBA(YUV_COLOUR_SPACE::BT2020))
+  {
+    std::cout << "BT.2020 RGBA conversion check failed" << std::endl;
+    return -3;
+  }
+  std::cout << "Scaler checks passed" << std::endl;
+  return 0;
+}
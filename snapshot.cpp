@@ -0,0 +1,314 @@
+#include "snapshot.hpp"
+
+#include <boost/scope_exit.hpp>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+#include "gl.hpp"
+
+SNAPSHOT::SNAPSHOT()
+  : next_readback_(0)
+  , max_jobs_(0)
+  , sequence_(0)
+  , running_(false)
+  , sws_context_(nullptr)
+  , captured_(0)
+  , saved_(0)
+  , dropped_(0)
+  , failed_(0)
+{
+}
+
+SNAPSHOT::~SNAPSHOT()
+{
+  Destroy();
+}
+
+int SNAPSHOT::Init(const size_t readbacks, const size_t max_jobs)
+{
+  Destroy();
+  if (readbacks == 0)
+  {
+    std::cout << "Invalid snapshot readback count" << std::endl;
+    return -1;
+  }
+  std::vector<GLuint> pbos(readbacks, 0);
+  GL_CHECK(glGenBuffers(static_cast<GLsizei>(pbos.size()), pbos.data()));
+  for (const GLuint pbo : pbos)
+  {
+    readbacks_.push_back(SNAPSHOT_READBACK(pbo));
+  }
+  max_jobs_ = max_jobs;
+  running_ = true;
+  thread_ = std::thread([this](){ Run(); });
+  return 0;
+}
+
+void SNAPSHOT::Destroy()
+{
+  // Outstanding readbacks are abandoned, but anything already queued is still encoded
+  for (SNAPSHOT_READBACK& readback : readbacks_)
+  {
+    if (readback.fence_)
+    {
+      GL_CHECK(glDeleteSync(readback.fence_));
+    }
+    GL_CHECK(glDeleteBuffers(1, &readback.pbo_));
+  }
+  readbacks_.clear();
+  next_readback_ = 0;
+  if (thread_.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+    }
+    condition_.notify_all();
+    thread_.join();
+  }
+  jobs_.clear();
+  if (sws_context_)
+  {
+    sws_freeContext(sws_context_);
+    sws_context_ = nullptr;
+  }
+}
+
+int SNAPSHOT::Capture(const GLuint frame_buffer, const GLsizei width, const GLsizei height, const SNAPSHOT_FORMAT format)
+{
+  if (readbacks_.empty())
+  {
+    return -1;
+  }
+  SNAPSHOT_READBACK& readback = readbacks_[next_readback_];
+  if (readback.fence_)
+  {
+    // Every readback is still in flight, so drop this snapshot rather than stall
+    ++dropped_;
+    return 1;
+  }
+  const GLsizeiptr size = static_cast<GLsizeiptr>(width) * static_cast<GLsizeiptr>(height) * 4;
+  GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, frame_buffer));
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo_));
+  if (readback.size_ != size)
+  {
+    GL_CHECK(glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ));
+    readback.size_ = size;
+  }
+  GL_CHECK(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+  readback.fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  if (readback.fence_ == nullptr)
+  {
+    std::cout << "Failed to create snapshot fence" << std::endl;
+    ++failed_;
+    return -2;
+  }
+  // Name the file now so it reflects when the frame was on screen rather than when it was encoded
+  const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+  std::tm tm;
+  localtime_r(&now, &tm);
+  char timestamp[32];
+  std::strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &tm);
+  readback.width_ = width;
+  readback.height_ = height;
+  readback.format_ = format;
+  readback.path_ = std::string("snapshot_") + timestamp + "_" + std::to_string(sequence_++) + ((format == SNAPSHOT_FORMAT::PNG) ? ".png" : ".jpg");
+  next_readback_ = (next_readback_ + 1) % readbacks_.size();
+  ++captured_;
+  return 0;
+}
+
+void SNAPSHOT::Poll()
+{
+  // Collect in capture order, stopping at the first readback the GPU has not finished
+  for (size_t i = 0; i < readbacks_.size(); ++i)
+  {
+    SNAPSHOT_READBACK& readback = readbacks_[(next_readback_ + i) % readbacks_.size()];
+    if (readback.fence_ == nullptr)
+    {
+      continue;
+    }
+    const GLenum status = glClientWaitSync(readback.fence_, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+      break;
+    }
+    GL_CHECK(glDeleteSync(readback.fence_));
+    readback.fence_ = nullptr;
+    if (status == GL_WAIT_FAILED)
+    {
+      std::cout << "Failed to wait for snapshot fence" << std::endl;
+      ++failed_;
+      continue;
+    }
+    SNAPSHOT_JOB job;
+    job.width_ = readback.width_;
+    job.height_ = readback.height_;
+    job.format_ = readback.format_;
+    job.path_ = readback.path_;
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo_));
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.size_, GL_MAP_READ_BIT);
+    if (pixels == nullptr)
+    {
+      std::cout << "Failed to map snapshot buffer" << std::endl;
+      GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+      ++failed_;
+      continue;
+    }
+    job.pixels_.assign(reinterpret_cast<const uint8_t*>(pixels), reinterpret_cast<const uint8_t*>(pixels) + readback.size_);
+    GL_CHECK(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (jobs_.size() >= max_jobs_)
+      {
+        ++dropped_;
+        continue;
+      }
+      jobs_.push_back(std::move(job));
+    }
+    condition_.notify_one();
+  }
+}
+
+size_t SNAPSHOT::GetQueued()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return jobs_.size();
+}
+
+void SNAPSHOT::Run()
+{
+  while (true)
+  {
+    SNAPSHOT_JOB job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this](){ return (!running_ || !jobs_.empty()); });
+      if (jobs_.empty())
+      {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    if (Encode(job))
+    {
+      ++failed_;
+      continue;
+    }
+    ++saved_;
+  }
+}
+
+int SNAPSHOT::Encode(const SNAPSHOT_JOB& job)
+{
+  const AVCodecID codec_id = (job.format_ == SNAPSHOT_FORMAT::PNG) ? AV_CODEC_ID_PNG : AV_CODEC_ID_MJPEG;
+  const AVPixelFormat pixel_format = (job.format_ == SNAPSHOT_FORMAT::PNG) ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_YUVJ420P;
+  const AVCodec* codec = avcodec_find_encoder(codec_id);
+  if (codec == nullptr)
+  {
+    std::cout << "Failed to find snapshot encoder" << std::endl;
+    return -1;
+  }
+  AVCodecContext* codec_context = avcodec_alloc_context3(codec);
+  if (codec_context == nullptr)
+  {
+    std::cout << "Failed to allocate snapshot encoder" << std::endl;
+    return -2;
+  }
+  BOOST_SCOPE_EXIT(&codec_context)
+  {
+    avcodec_free_context(&codec_context);
+  }
+  BOOST_SCOPE_EXIT_END
+  codec_context->width = job.width_;
+  codec_context->height = job.height_;
+  codec_context->pix_fmt = pixel_format;
+  codec_context->time_base = av_make_q(1, 25);
+  if (job.format_ == SNAPSHOT_FORMAT::JPEG)
+  {
+    codec_context->flags |= AV_CODEC_FLAG_QSCALE;
+    codec_context->global_quality = FF_QP2LAMBDA * 2;
+  }
+  if (avcodec_open2(codec_context, codec, nullptr) < 0)
+  {
+    std::cout << "Failed to open snapshot encoder" << std::endl;
+    return -3;
+  }
+  AVFrame* frame = av_frame_alloc();
+  if (frame == nullptr)
+  {
+    std::cout << "Failed to allocate snapshot frame" << std::endl;
+    return -4;
+  }
+  BOOST_SCOPE_EXIT(&frame)
+  {
+    av_frame_free(&frame);
+  }
+  BOOST_SCOPE_EXIT_END
+  frame->format = pixel_format;
+  frame->width = job.width_;
+  frame->height = job.height_;
+  frame->pts = 0;
+  frame->quality = codec_context->global_quality;
+  if (av_frame_get_buffer(frame, 0) < 0)
+  {
+    std::cout << "Failed to allocate snapshot frame buffer" << std::endl;
+    return -5;
+  }
+  sws_context_ = sws_getCachedContext(sws_context_, job.width_, job.height_, AV_PIX_FMT_RGBA, job.width_, job.height_, pixel_format, SWS_BILINEAR, nullptr, nullptr, nullptr);
+  if (sws_context_ == nullptr)
+  {
+    std::cout << "Failed to create snapshot scaler" << std::endl;
+    return -6;
+  }
+  // GL rows are bottom up, so start at the last row and walk backwards
+  const uint8_t* source[] = { job.pixels_.data() + (static_cast<size_t>(job.height_ - 1) * job.width_ * 4) };
+  const int source_stride[] = { -(job.width_ * 4) };
+  sws_scale(sws_context_, source, source_stride, 0, job.height_, frame->data, frame->linesize);
+  if ((avcodec_send_frame(codec_context, frame) < 0) || (avcodec_send_frame(codec_context, nullptr) < 0))
+  {
+    std::cout << "Failed to send snapshot frame" << std::endl;
+    return -7;
+  }
+  AVPacket* packet = av_packet_alloc();
+  if (packet == nullptr)
+  {
+    std::cout << "Failed to allocate snapshot packet" << std::endl;
+    return -8;
+  }
+  BOOST_SCOPE_EXIT(&packet)
+  {
+    av_packet_free(&packet);
+  }
+  BOOST_SCOPE_EXIT_END
+  std::ofstream file(job.path_, std::ios::binary);
+  if (!file.is_open())
+  {
+    std::cout << "Failed to open snapshot file: " << job.path_ << std::endl;
+    return -9;
+  }
+  while (avcodec_receive_packet(codec_context, packet) == 0)
+  {
+    file.write(reinterpret_cast<const char*>(packet->data), packet->size);
+    av_packet_unref(packet);
+  }
+  if (!file.good())
+  {
+    std::cout << "Failed to write snapshot file: " << job.path_ << std::endl;
+    return -10;
+  }
+  return 0;
+}
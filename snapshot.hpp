@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <GLES3/gl3.h>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SwsContext;
+
+enum class SNAPSHOT_FORMAT
+{
+  PNG,
+  JPEG
+};
+
+struct SNAPSHOT_READBACK
+{
+  SNAPSHOT_READBACK(const GLuint pbo)
+    : pbo_(pbo)
+    , size_(0)
+    , fence_(nullptr)
+    , width_(0)
+    , height_(0)
+    , format_(SNAPSHOT_FORMAT::PNG)
+  {
+  }
+
+  GLuint pbo_;
+  GLsizeiptr size_;
+  GLsync fence_;
+  GLsizei width_;
+  GLsizei height_;
+  SNAPSHOT_FORMAT format_;
+  std::string path_;
+
+};
+
+struct SNAPSHOT_JOB
+{
+  std::vector<uint8_t> pixels_;
+  GLsizei width_;
+  GLsizei height_;
+  SNAPSHOT_FORMAT format_;
+  std::string path_;
+
+};
+
+// Reads frame buffers back through a ring of pixel buffer objects so the render thread never waits on the GPU, the pixels are then encoded on a worker thread
+class SNAPSHOT
+{
+ public:
+
+  SNAPSHOT();
+  ~SNAPSHOT();
+
+  int Init(const size_t readbacks, const size_t max_jobs);
+  void Destroy();
+
+  int Capture(const GLuint frame_buffer, const GLsizei width, const GLsizei height, const SNAPSHOT_FORMAT format);
+  void Poll();
+
+  unsigned int GetCaptured() const { return captured_; }
+  unsigned int GetSaved() const { return saved_; }
+  unsigned int GetDropped() const { return dropped_; }
+  unsigned int GetFailed() const { return failed_; }
+  size_t GetQueued();
+
+ private:
+
+  void Run();
+  int Encode(const SNAPSHOT_JOB& job);
+
+  std::vector<SNAPSHOT_READBACK> readbacks_;
+  size_t next_readback_;
+  size_t max_jobs_;
+  unsigned int sequence_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<SNAPSHOT_JOB> jobs_;
+  bool running_;
+
+  SwsContext* sws_context_; // Only used by the worker thread
+
+  std::atomic<unsigned int> captured_;
+  std::atomic<unsigned int> saved_;
+  std::atomic<unsigned int> dropped_;
+  std::atomic<unsigned int> failed_;
+
+};
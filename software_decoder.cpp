@@ -0,0 +1,114 @@
+#include "software_decoder.hpp"
+
+#include <cerrno>
+#include <iostream>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+SOFTWARE_DECODER::SOFTWARE_DECODER()
+  : codec_context_(nullptr)
+  , frame_(nullptr)
+  , decoded_(0)
+  , damaged_(0)
+{
+}
+
+SOFTWARE_DECODER::~SOFTWARE_DECODER()
+{
+  Destroy();
+}
+
+int SOFTWARE_DECODER::Init(const AVCodecParameters* parameters)
+{
+  Destroy();
+  const AVCodec* codec = avcodec_find_decoder(parameters->codec_id);
+  if (codec == nullptr)
+  {
+    std::cout << "Failed to find software decoder" << std::endl;
+    return -1;
+  }
+  codec_context_ = avcodec_alloc_context3(codec);
+  if (codec_context_ == nullptr)
+  {
+    std::cout << "Failed to allocate software decoder" << std::endl;
+    return -2;
+  }
+  if (avcodec_parameters_to_context(codec_context_, parameters) < 0)
+  {
+    std::cout << "Failed to set software decoder parameters" << std::endl;
+    Destroy();
+    return -3;
+  }
+  codec_context_->thread_count = 0; // One per core
+  if (avcodec_open2(codec_context_, codec, nullptr) < 0)
+  {
+    std::cout << "Failed to open software decoder" << std::endl;
+    Destroy();
+    return -4;
+  }
+  frame_ = av_frame_alloc();
+  if (frame_ == nullptr)
+  {
+    std::cout << "Failed to allocate software decoder frame" << std::endl;
+    Destroy();
+    return -5;
+  }
+  return 0;
+}
+
+void SOFTWARE_DECODER::Destroy()
+{
+  if (frame_)
+  {
+    av_frame_free(&frame_);
+  }
+  if (codec_context_)
+  {
+    avcodec_free_context(&codec_context_);
+  }
+}
+
+void SOFTWARE_DECODER::Flush()
+{
+  if (codec_context_)
+  {
+    avcodec_flush_buffers(codec_context_);
+  }
+}
+
+int SOFTWARE_DECODER::SendPacket(const AVPacket* packet)
+{
+  const int ret = avcodec_send_packet(codec_context_, packet);
+  if (ret < 0)
+  {
+    std::cout << "Failed to send packet to software decoder: " << ret << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+int SOFTWARE_DECODER::GetFrame(const AVFrame*& frame)
+{
+  const int ret = avcodec_receive_frame(codec_context_, frame_);
+  if ((ret == AVERROR(EAGAIN)) || (ret == AVERROR_EOF))
+  {
+    return 1;
+  }
+  else if (ret < 0)
+  {
+    std::cout << "Failed to receive frame from software decoder: " << ret << std::endl;
+    return -1;
+  }
+  if (frame_->decode_error_flags || (frame_->flags & AV_FRAME_FLAG_CORRUPT))
+  {
+    av_frame_unref(frame_);
+    ++damaged_;
+    return 2;
+  }
+  ++decoded_;
+  frame = frame_;
+  return 0;
+}
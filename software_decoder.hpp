@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+struct AVCodecContext;
+struct AVCodecParameters;
+struct AVFrame;
+struct AVPacket;
+
+// avcodec decoding into CPU memory, for codecs the VPU lacks and for machines without Rockchip hardware
+class SOFTWARE_DECODER
+{
+ public:
+
+  SOFTWARE_DECODER();
+  ~SOFTWARE_DECODER();
+
+  int Init(const AVCodecParameters* parameters);
+  void Destroy();
+
+  // Discard anything buffered, for when the demuxer seeks
+  void Flush();
+  int SendPacket(const AVPacket* packet);
+  // Returns 0 with a frame that stays valid until the next call, 1 when the decoder needs more data, 2 when a damaged frame was dropped, or an error
+  int GetFrame(const AVFrame*& frame);
+
+  uint64_t GetDecoded() const { return decoded_; }
+  uint64_t GetDamaged() const { return damaged_; }
+
+ private:
+
+  AVCodecContext* codec_context_;
+  AVFrame* frame_;
+  uint64_t decoded_;
+  uint64_t damaged_;
+
+};
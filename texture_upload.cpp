@@ -0,0 +1,210 @@
+#include "texture_upload.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "gl.hpp"
+
+TEXTURE_UPLOAD::TEXTURE_UPLOAD()
+  : next_slot_(0)
+  , format_(TEXTURE_UPLOAD_FORMAT::NV12)
+  , width_(0)
+  , height_(0)
+  , textures_{ 0, 0, 0 }
+  , uploaded_(0)
+  , bytes_(0)
+  , stalls_(0)
+  , upload_time_(0.0)
+  , bandwidth_(0.0)
+{
+}
+
+TEXTURE_UPLOAD::~TEXTURE_UPLOAD()
+{
+  Destroy();
+}
+
+int TEXTURE_UPLOAD::Init(const size_t slots)
+{
+  Destroy();
+  if (slots == 0)
+  {
+    std::cout << "Invalid texture upload slot count" << std::endl;
+    return -1;
+  }
+  std::vector<GLuint> pbos(slots, 0);
+  GL_CHECK(glGenBuffers(static_cast<GLsizei>(pbos.size()), pbos.data()));
+  for (const GLuint pbo : pbos)
+  {
+    slots_.push_back(TEXTURE_UPLOAD_SLOT(pbo));
+  }
+  return 0;
+}
+
+void TEXTURE_UPLOAD::Destroy()
+{
+  for (TEXTURE_UPLOAD_SLOT& slot : slots_)
+  {
+    if (slot.fence_)
+    {
+      GL_CHECK(glDeleteSync(slot.fence_));
+    }
+    GL_CHECK(glDeleteBuffers(1, &slot.pbo_));
+  }
+  slots_.clear();
+  next_slot_ = 0;
+  DestroyTextures();
+}
+
+int TEXTURE_UPLOAD::Upload(const TEXTURE_UPLOAD_FORMAT format, const GLsizei width, const GLsizei height, const uint8_t* const* planes, const int* strides)
+{
+  if (slots_.empty())
+  {
+    return -1;
+  }
+  const size_t plane_count = (format == TEXTURE_UPLOAD_FORMAT::NV12) ? 2 : 3;
+  for (size_t i = 0; i < plane_count; ++i)
+  {
+    if ((planes[i] == nullptr) || (strides[i] <= 0))
+    {
+      std::cout << "Invalid texture upload plane " << i << std::endl;
+      return -2;
+    }
+  }
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if ((textures_[0] == 0) || (format != format_) || (width != width_) || (height != height_))
+  {
+    if (CreateTextures(format, width, height))
+    {
+      return -3;
+    }
+  }
+  TEXTURE_UPLOAD_SLOT& slot = slots_[next_slot_];
+  if (slot.fence_)
+  {
+    // Normally long since signalled, if not then the ring is too short for how far behind the GPU is running
+    GLenum status = glClientWaitSync(slot.fence_, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+      ++stalls_;
+      status = glClientWaitSync(slot.fence_, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+    }
+    GL_CHECK(glDeleteSync(slot.fence_));
+    slot.fence_ = nullptr;
+    if ((status == GL_TIMEOUT_EXPIRED) || (status == GL_WAIT_FAILED))
+    {
+      std::cout << "Failed to wait for texture upload fence" << std::endl;
+      return -4;
+    }
+  }
+  // The planes sit back to back in the buffer, keeping their source strides
+  const GLsizei plane_widths[TEXTURE_UPLOAD_MAX_PLANES] = { width, (width + 1) / 2, (width + 1) / 2 };
+  const GLsizei plane_heights[TEXTURE_UPLOAD_MAX_PLANES] = { height, (height + 1) / 2, (height + 1) / 2 };
+  const GLint plane_pixel_sizes[TEXTURE_UPLOAD_MAX_PLANES] = { 1, (format == TEXTURE_UPLOAD_FORMAT::NV12) ? 2 : 1, 1 };
+  GLsizeiptr offsets[TEXTURE_UPLOAD_MAX_PLANES] = { 0, 0, 0 };
+  GLsizeiptr size = 0;
+  for (size_t i = 0; i < plane_count; ++i)
+  {
+    offsets[i] = size;
+    size += static_cast<GLsizeiptr>(strides[i]) * static_cast<GLsizeiptr>(plane_heights[i]);
+  }
+  GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo_));
+  if (slot.size_ < size)
+  {
+    GL_CHECK(glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW));
+    slot.size_ = size;
+  }
+  // The fence has passed so nothing can still be reading this buffer, there is no need for the driver to synchronise
+  uint8_t* ptr = reinterpret_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+  if (ptr == nullptr)
+  {
+    std::cout << "Failed to map texture upload buffer" << std::endl;
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    return -5;
+  }
+  for (size_t i = 0; i < plane_count; ++i)
+  {
+    std::memcpy(ptr + offsets[i], planes[i], static_cast<size_t>(strides[i]) * static_cast<size_t>(plane_heights[i]));
+  }
+  if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE)
+  {
+    std::cout << "Texture upload buffer was corrupted" << std::endl;
+    GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+    return -6;
+  }
+  GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+  for (size_t i = 0; i < plane_count; ++i)
+  {
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, textures_[i]));
+    GL_CHECK(glPixelStorei(GL_UNPACK_ROW_LENGTH, strides[i] / plane_pixel_sizes[i]));
+    GL_CHECK(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane_widths[i], plane_heights[i], (plane_pixel_sizes[i] == 2) ? GL_RG : GL_RED, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(offsets[i])));
+  }
+  GL_CHECK(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+  GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+  GL_CHECK(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+  slot.fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  if (slot.fence_ == nullptr)
+  {
+    std::cout << "Failed to create texture upload fence" << std::endl;
+  }
+  next_slot_ = (next_slot_ + 1) % slots_.size();
+  // This is the time the render thread spends, the copy out of the buffer happens later on the GPU
+  const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  const double bandwidth = (elapsed > 0.0) ? ((static_cast<double>(size) / (1024.0 * 1024.0)) / (elapsed / 1000.0)) : 0.0;
+  if (uploaded_ == 0)
+  {
+    upload_time_ = elapsed;
+    bandwidth_ = bandwidth;
+  }
+  else
+  {
+    upload_time_ = (upload_time_ * 0.9) + (elapsed * 0.1);
+    bandwidth_ = (bandwidth_ * 0.9) + (bandwidth * 0.1);
+  }
+  ++uploaded_;
+  bytes_ += size;
+  return 0;
+}
+
+int TEXTURE_UPLOAD::CreateTextures(const TEXTURE_UPLOAD_FORMAT format, const GLsizei width, const GLsizei height)
+{
+  DestroyTextures();
+  if ((width <= 0) || (height <= 0))
+  {
+    std::cout << "Invalid texture upload size " << width << "x" << height << std::endl;
+    return -1;
+  }
+  format_ = format;
+  width_ = width;
+  height_ = height;
+  const size_t plane_count = GetPlaneCount();
+  GL_CHECK(glGenTextures(static_cast<GLsizei>(plane_count), textures_));
+  for (size_t i = 0; i < plane_count; ++i)
+  {
+    const GLenum internal_format = ((i == 1) && (format == TEXTURE_UPLOAD_FORMAT::NV12)) ? GL_RG8 : GL_R8;
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, textures_[i]));
+    GL_CHECK(glTexStorage2D(GL_TEXTURE_2D, 1, internal_format, (i == 0) ? width : ((width + 1) / 2), (i == 0) ? height : ((height + 1) / 2)));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+  }
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+  return 0;
+}
+
+void TEXTURE_UPLOAD::DestroyTextures()
+{
+  for (GLuint& texture : textures_)
+  {
+    if (texture)
+    {
+      GL_CHECK(glDeleteTextures(1, &texture));
+      texture = 0;
+    }
+  }
+  width_ = 0;
+  height_ = 0;
+}
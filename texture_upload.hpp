@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <GLES3/gl3.h>
+#include <stdint.h>
+#include <vector>
+
+const size_t TEXTURE_UPLOAD_MAX_PLANES = 3;
+
+enum class TEXTURE_UPLOAD_FORMAT
+{
+  NV12, // R8 luma, RG8 chroma
+  YUV420P // R8 luma, R8 U, R8 V
+};
+
+struct TEXTURE_UPLOAD_SLOT
+{
+  TEXTURE_UPLOAD_SLOT(const GLuint pbo)
+    : pbo_(pbo)
+    , size_(0)
+    , fence_(nullptr)
+  {
+  }
+
+  GLuint pbo_;
+  GLsizeiptr size_;
+  GLsync fence_;
+
+};
+
+// Streams CPU frames into plane textures through a ring of pixel unpack buffers, so the copy into a buffer never waits on the GPU still reading the previous one
+class TEXTURE_UPLOAD
+{
+ public:
+
+  TEXTURE_UPLOAD();
+  ~TEXTURE_UPLOAD();
+
+  int Init(const size_t slots);
+  void Destroy();
+
+  // Strides are in bytes and may be padded, each plane is copied in one go and the padding skipped by GL_UNPACK_ROW_LENGTH
+  int Upload(const TEXTURE_UPLOAD_FORMAT format, const GLsizei width, const GLsizei height, const uint8_t* const* planes, const int* strides);
+
+  TEXTURE_UPLOAD_FORMAT GetFormat() const { return format_; }
+  GLuint GetTexture(const size_t plane) const { return textures_[plane]; }
+  GLsizei GetWidth() const { return width_; }
+  GLsizei GetHeight() const { return height_; }
+  uint64_t GetUploaded() const { return uploaded_; }
+  uint64_t GetBytes() const { return bytes_; }
+  uint64_t GetStalls() const { return stalls_; }
+  double GetUploadTime() const { return upload_time_; } // Milliseconds
+  double GetBandwidth() const { return bandwidth_; } // MB/s
+
+ private:
+
+  size_t GetPlaneCount() const { return ((format_ == TEXTURE_UPLOAD_FORMAT::NV12) ? 2 : 3); }
+  int CreateTextures(const TEXTURE_UPLOAD_FORMAT format, const GLsizei width, const GLsizei height);
+  void DestroyTextures();
+
+  std::vector<TEXTURE_UPLOAD_SLOT> slots_;
+  size_t next_slot_;
+
+  TEXTURE_UPLOAD_FORMAT format_;
+  GLsizei width_;
+  GLsizei height_;
+  GLuint textures_[TEXTURE_UPLOAD_MAX_PLANES];
+
+  uint64_t uploaded_;
+  uint64_t bytes_;
+  uint64_t stalls_;
+  double upload_time_;
+  double bandwidth_;
+
+};